@@ -0,0 +1,203 @@
+#include "alloctrack.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+AllocationCounts AllocationCounts::operator-(const AllocationCounts& earlier) const
+{
+	AllocationCounts d;
+	d.allocations = allocations - earlier.allocations;
+	d.frees = frees - earlier.frees;
+	d.bytes = bytes - earlier.bytes;
+	return d;
+}
+
+/* plain data, so the thread's counters need no constructor before its first allocation*/
+struct ThreadAllocations{
+	long long allocations, frees, bytes;
+	long long live, peak;	//this thread's allocations less its frees, for the peak of a stage
+};
+static thread_local ThreadAllocations counts;
+
+#ifdef ENABLE_ALLOC_TRACKING
+
+static atomic<long long> live(0), peak(0);
+
+/* each block carries its size ahead of it, a whole alignment unit so the block stays aligned*/
+static const size_t header = 16;
+
+static void* allocate(size_t size)
+{
+	char* block = (char*)malloc(size + header);
+	if(!block)
+		return 0;
+	*(size_t*)block = size;
+
+	counts.allocations++;
+	counts.bytes += size;
+	counts.live += size;
+	if(counts.live > counts.peak)
+		counts.peak = counts.live;
+
+	long long now = live.fetch_add(size, memory_order_relaxed) + size;
+	long long highest = peak.load(memory_order_relaxed);
+	while(now > highest && !peak.compare_exchange_weak(highest, now, memory_order_relaxed))
+		;
+	return block + header;
+}
+
+static void release(void* pointer)
+{
+	if(!pointer)
+		return;
+	char* block = (char*)pointer - header;
+	size_t size = *(size_t*)block;
+	counts.frees++;
+	counts.live -= size;
+	live.fetch_sub(size, memory_order_relaxed);
+	free(block);
+}
+
+static void* allocateOrThrow(size_t size)
+{
+	void* block = allocate(size);
+	if(!block)
+		throw bad_alloc();
+	return block;
+}
+
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return allocate(size); }
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, const nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, const nothrow_t&) noexcept { release(pointer); }
+
+bool allocationTracking() { return true; }
+long long liveBytes() { return live.load(memory_order_relaxed); }
+long long peakLiveBytes() { return peak.load(memory_order_relaxed); }
+
+#else
+
+bool allocationTracking() { return false; }
+long long liveBytes() { return 0; }
+long long peakLiveBytes() { return 0; }
+
+#endif
+
+AllocationCounts threadAllocations()
+{
+	AllocationCounts c;
+	c.allocations = counts.allocations;
+	c.frees = counts.frees;
+	c.bytes = counts.bytes;
+	return c;
+}
+
+struct StageTotals{
+	const char* name;
+	int runs;
+	AllocationCounts counts;
+	long long peak;		//most the stage's thread had live above where it started
+};
+static mutex stagesLock;
+static vector<StageTotals> stages;
+
+AllocationStage::AllocationStage(const char* _name): name(_name), start(threadAllocations()),
+	startLive(counts.live), outerPeak(counts.peak)
+{
+	counts.peak = counts.live;
+}
+
+AllocationStage::~AllocationStage()
+{
+	AllocationCounts used = threadAllocations() - start;
+	long long stagePeak = counts.peak - startLive;
+	if(outerPeak > counts.peak)
+		counts.peak = outerPeak;
+
+	lock_guard<mutex> guard(stagesLock);
+	for(size_t s = 0; s < stages.size(); s++)
+	{
+		if(stages[s].name != name)
+			continue;
+		StageTotals& t = stages[s];
+		t.runs++;
+		t.counts.allocations += used.allocations;
+		t.counts.frees += used.frees;
+		t.counts.bytes += used.bytes;
+		if(stagePeak > t.peak)
+			t.peak = stagePeak;
+		return;
+	}
+
+	StageTotals t;
+	t.name = name;
+	t.runs = 1;
+	t.counts = used;
+	t.peak = stagePeak;
+	stages.push_back(t);
+}
+
+void FrameAllocations::end(bool steady)
+{
+	AllocationCounts used = threadAllocations() - start;
+	frames++;
+	total.allocations += used.allocations;
+	total.bytes += used.bytes;
+	if(!steady)
+		return;
+
+	steadyFrames++;
+	if(used.allocations > 0)
+	{
+		steadyAllocating++;
+		if(used.allocations > worstSteady)
+			worstSteady = used.allocations;
+	}
+}
+
+void FrameAllocations::print() const
+{
+	if(frames == 0)
+		return;
+	streamsize precision = cout.precision();
+	cout << fixed << setprecision(1);
+	cout << "Frames allocated " << float(total.allocations)/frames << " times and "
+		 << float(total.bytes)/frames << " bytes each on average; " << steadyAllocating << " of "
+		 << steadyFrames << " steady frames allocated";
+	if(steadyAllocating > 0)
+		cout << ", at worst " << worstSteady << " times";
+	cout << endl;
+	cout.unsetf(ios::floatfield);
+	cout.precision(precision);
+}
+
+void printAllocationReport()
+{
+	if(!allocationTracking())
+		return;
+
+	cout << "Live " << liveBytes() << " bytes at exit, peak " << peakLiveBytes() << " bytes" << endl;
+	lock_guard<mutex> guard(stagesLock);
+	if(stages.empty())
+		return;
+
+	cout << left << setw(24) << "stage" << right << setw(6) << "runs" << setw(14) << "allocs/run"
+		 << setw(14) << "bytes/run" << setw(14) << "peak bytes" << endl;
+	for(size_t s = 0; s < stages.size(); s++)
+	{
+		const StageTotals& t = stages[s];
+		cout << left << setw(24) << t.name << right << setw(6) << t.runs << setw(14) << t.counts.allocations/t.runs
+			 << setw(14) << t.counts.bytes/t.runs << setw(14) << t.peak << endl;
+	}
+}
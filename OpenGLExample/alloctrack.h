@@ -0,0 +1,57 @@
+#ifndef ALLOCTRACK_H
+#define ALLOCTRACK_H
+
+/* Counts every operator new and delete. Built with ENABLE_ALLOC_TRACKING (make ALLOCS=1)
+ * the global operators are replaced: each thread keeps its own counts, so a stage or a
+ * frame sees only what its own thread allocated, and the live and peak bytes are kept
+ * across all threads. Without it nothing is replaced and every count reads 0. */
+
+struct AllocationCounts{
+	long long allocations, frees, bytes;
+
+	AllocationCounts(): allocations(0), frees(0), bytes(0){}
+	AllocationCounts operator-(const AllocationCounts& earlier) const;
+};
+
+bool allocationTracking();
+/* what the calling thread has allocated and freed so far */
+AllocationCounts threadAllocations();
+/* bytes allocated and not yet freed, by all threads, and the most there have ever been */
+long long liveBytes();
+long long peakLiveBytes();
+
+/* adds what the calling thread allocates in the rest of the scope to the stage called
+ * name, which must be a literal. Stages nest, each counting its inner ones too */
+class AllocationStage{
+public:
+	explicit AllocationStage(const char* name);
+	~AllocationStage();
+
+private:
+	const char* name;
+	AllocationCounts start;
+	long long startLive, outerPeak;
+};
+
+/* the main thread's allocations frame by frame. Steady frames, once the track is up and
+ * nothing is loading, are expected to allocate nothing at all */
+class FrameAllocations{
+public:
+	FrameAllocations(): frames(0), steadyFrames(0), steadyAllocating(0), worstSteady(0){}
+
+	void begin() { start = threadAllocations(); }
+	void end(bool steady);
+
+	int steadyFramesThatAllocated() const { return steadyAllocating; }
+	void print() const;
+
+private:
+	AllocationCounts start, total;
+	int frames, steadyFrames, steadyAllocating;
+	long long worstSteady;
+};
+
+/* totals, live and peak bytes and every stage so far */
+void printAllocationReport();
+
+#endif
@@ -0,0 +1,204 @@
+#include "analytics.h"
+#include "frenet.h"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+
+static const float G = 9.81f;
+static const float minSpeed = 0.1f;	//keeps the time step finite where the cart crests at rest
+
+/* linear interpolation of one channel between coarse samples a and b*/
+static inline float lerpChannel(const vector<float>& c, size_t a, size_t b, float t)
+{
+	return c[a] + t*(c[b] - c[a]);
+}
+
+bool analyzeLap(const vector<vec3>& points, const vector<float>& speeds, int startIndex,
+				float resolution, RideProfile* profile)
+{
+	size_t n = points.size();
+	if(n < 3 || speeds.size() != n || resolution <= 0.0f)
+		return false;
+
+	/* per point channels in lap order, entry n closes the lap back at the start point*/
+	vector<float> s(n + 1), v(n + 1), at(n + 1);
+	vector<float> kx(n + 1), ky(n + 1), kz(n + 1);
+	vector<float> tx(n + 1), ty(n + 1), tz(n + 1);
+
+	for(size_t k = 0; k <= n; k++)
+	{
+		size_t i = (startIndex + k) % n;
+		vec3 prevPos = points[(i + n - 1) % n];
+		vec3 currPos = points[i];
+		vec3 nextPos = points[(i + 1) % n];
+
+		vec3 T = tangentTemp(nextPos, prevPos);
+		float r = radiusOfCurvature(nextPos, currPos, prevPos);
+		vec3 K = (r > 0.0f) ? centDir(nextPos, currPos, prevPos) / r : vec3(0.0f);
+
+		s[k] = (k == 0) ? 0.0f : s[k - 1] + getLength(currPos - prevPos);
+		v[k] = std::max(speeds[i], minSpeed);
+		kx[k] = K.x; ky[k] = K.y; kz[k] = K.z;
+		tx[k] = T.x; ty[k] = T.y; tz[k] = T.z;
+	}
+
+	/* longitudinal acceleration v dv/ds, as the central difference of v^2/2 */
+	for(size_t k = 0; k <= n; k++)
+	{
+		size_t kp = (k == 0) ? n - 1 : k - 1;
+		size_t kn = (k == n) ? 1 : k + 1;
+		float dsPrev = (k == 0) ? s[n] - s[n - 1] : s[k] - s[k - 1];
+		float dsNext = (k == n) ? s[1] - s[0] : s[k + 1] - s[k];
+		at[k] = (v[kn]*v[kn] - v[kp]*v[kp]) / (2.0f*(dsPrev + dsNext));
+	}
+
+	/* resample every channel to the fixed arc length step */
+	size_t count = (size_t)(s[n] / resolution) + 1;
+	vector<float> rk[3], rt[3], ra(count);
+	for(int c = 0; c < 3; c++)
+	{
+		rk[c].resize(count);
+		rt[c].resize(count);
+	}
+
+	profile->distance.resize(count);
+	profile->time.resize(count);
+	profile->speed.resize(count);
+	profile->gVertical.resize(count);
+	profile->gLateral.resize(count);
+	profile->gLongitudinal.resize(count);
+	profile->jerk.resize(count);
+
+	size_t seg = 0;
+	for(size_t j = 0; j < count; j++)
+	{
+		float d = j*resolution;
+		while(seg + 1 < n && s[seg + 1] < d)
+			seg++;
+
+		float len = s[seg + 1] - s[seg];
+		float t = (len > 0.0f) ? (d - s[seg]) / len : 0.0f;
+
+		profile->distance[j] = d;
+		profile->speed[j] = lerpChannel(v, seg, seg + 1, t);
+		ra[j] = lerpChannel(at, seg, seg + 1, t);
+		rk[0][j] = lerpChannel(kx, seg, seg + 1, t);
+		rk[1][j] = lerpChannel(ky, seg, seg + 1, t);
+		rk[2][j] = lerpChannel(kz, seg, seg + 1, t);
+		rt[0][j] = lerpChannel(tx, seg, seg + 1, t);
+		rt[1][j] = lerpChannel(ty, seg, seg + 1, t);
+		rt[2][j] = lerpChannel(tz, seg, seg + 1, t);
+	}
+
+	/* felt force f = a - gravity projected on tangent T, lateral L = T x up and vertical U = L x T.
+	 * No branches or cross sample dependencies so the compiler can vectorize it*/
+	const float* sp = &profile->speed[0];
+	float* gv = &profile->gVertical[0];
+	float* gl = &profile->gLateral[0];
+	float* gs = &profile->gLongitudinal[0];
+	for(size_t j = 0; j < count; j++)
+	{
+		float v2 = sp[j]*sp[j];
+		float Tx = rt[0][j], Ty = rt[1][j], Tz = rt[2][j];
+		float invT = 1.0f / std::sqrt(std::max(Tx*Tx + Ty*Ty + Tz*Tz, 1e-12f));
+		Tx *= invT; Ty *= invT; Tz *= invT;
+
+		float fx = v2*rk[0][j] + ra[j]*Tx;
+		float fy = v2*rk[1][j] + ra[j]*Ty + G;
+		float fz = v2*rk[2][j] + ra[j]*Tz;
+
+		float h = std::sqrt(std::max(Tx*Tx + Tz*Tz, 1e-12f));
+		float Lx = -Tz / h, Lz = Tx / h;
+		float Ux = -Tx*Ty / h, Uy = h, Uz = -Tz*Ty / h;
+
+		gs[j] = (fx*Tx + fy*Ty + fz*Tz) / G;
+		gl[j] = (fx*Lx + fz*Lz) / G;
+		gv[j] = (fx*Ux + fy*Uy + fz*Uz) / G;
+	}
+
+	/* time is a running sum of step / average speed*/
+	profile->time[0] = 0.0f;
+	for(size_t j = 1; j < count; j++)
+		profile->time[j] = profile->time[j - 1] + resolution / (0.5f*(sp[j - 1] + sp[j]));
+
+	/* jerk as the central difference of the g vector over time*/
+	for(size_t j = 0; j < count; j++)
+	{
+		size_t a = (j == 0) ? 0 : j - 1;
+		size_t b = (j + 1 == count) ? j : j + 1;
+		float dt = profile->time[b] - profile->time[a];
+		float dVert = gv[b] - gv[a], dLat = gl[b] - gl[a], dLong = gs[b] - gs[a];
+		profile->jerk[j] = (dt > 0.0f) ? std::sqrt(dVert*dVert + dLat*dLat + dLong*dLong) / dt : 0.0f;
+	}
+
+	return true;
+}
+
+/* appends one channel to a binary file*/
+static void writeChannel(ofstream& out, const vector<float>& channel)
+{
+	out.write((const char*)&channel[0], sizeof(float)*channel.size());
+}
+
+bool writeRideProfile(const string& filename, const RideProfile& profile)
+{
+	bool csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0;
+	ofstream out(filename.c_str(), csv ? ios::out : ios::out | ios::binary);
+	if(!out.is_open())
+	{
+		cout << "Could not open " << filename << " for the ride profile" << endl;
+		return false;
+	}
+
+	if(csv)
+	{
+		out << "distance,time,speed,g_vertical,g_lateral,g_longitudinal,jerk\n";
+		for(size_t j = 0; j < profile.size(); j++)
+		{
+			out << profile.distance[j] << ',' << profile.time[j] << ',' << profile.speed[j] << ','
+				<< profile.gVertical[j] << ',' << profile.gLateral[j] << ','
+				<< profile.gLongitudinal[j] << ',' << profile.jerk[j] << '\n';
+		}
+	}
+	else
+	{
+		/* "RIDE", sample count, then each channel back to back in the order of RideProfile*/
+		uint32_t count = profile.size();
+		out.write("RIDE", 4);
+		out.write((const char*)&count, sizeof(count));
+		if(count > 0)
+		{
+			writeChannel(out, profile.distance);
+			writeChannel(out, profile.time);
+			writeChannel(out, profile.speed);
+			writeChannel(out, profile.gVertical);
+			writeChannel(out, profile.gLateral);
+			writeChannel(out, profile.gLongitudinal);
+			writeChannel(out, profile.jerk);
+		}
+	}
+
+	return out.good();
+}
+
+void printRideSummary(const RideProfile& profile)
+{
+	if(profile.size() == 0)
+		return;
+
+	cout << "Lap: " << profile.distance.back() << " m in " << profile.time.back() << " s, "
+		 << profile.size() << " samples" << endl;
+	cout << "  vertical g     " << *min_element(profile.gVertical.begin(), profile.gVertical.end())
+		 << " to " << *max_element(profile.gVertical.begin(), profile.gVertical.end()) << endl;
+	cout << "  lateral g      " << *min_element(profile.gLateral.begin(), profile.gLateral.end())
+		 << " to " << *max_element(profile.gLateral.begin(), profile.gLateral.end()) << endl;
+	cout << "  longitudinal g " << *min_element(profile.gLongitudinal.begin(), profile.gLongitudinal.end())
+		 << " to " << *max_element(profile.gLongitudinal.begin(), profile.gLongitudinal.end()) << endl;
+	cout << "  max jerk       " << *max_element(profile.jerk.begin(), profile.jerk.end()) << " g/s" << endl;
+	cout << "  top speed      " << *max_element(profile.speed.begin(), profile.speed.end()) << " m/s" << endl;
+}
@@ -0,0 +1,35 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include "glm/glm.hpp"
+#include <vector>
+#include <string>
+
+using namespace glm;
+
+/* Time series of the forces a rider feels over one lap, sampled at a fixed arc length step.
+ * Stored as one array per channel so the per sample math runs over contiguous floats. */
+struct RideProfile{
+	std::vector<float> distance;		//arc length from the start point (m)
+	std::vector<float> time;			//time since the start point (s)
+	std::vector<float> speed;			//m/s
+	std::vector<float> gVertical;		//g-forces in the unbanked track frame, 1g when sitting still
+	std::vector<float> gLateral;
+	std::vector<float> gLongitudinal;
+	std::vector<float> jerk;			//rate of change of the g-force vector (g/s)
+
+	size_t size() const { return distance.size(); }
+};
+
+/* Runs one lap over the closed curve points, starting at startIndex, with speeds[i] the
+ * velocity model's speed at points[i]. resolution is the arc length between output samples. */
+bool analyzeLap(const std::vector<vec3>& points, const std::vector<float>& speeds, int startIndex,
+				float resolution, RideProfile* profile);
+
+/* writes the profile as CSV if the filename ends in .csv, otherwise as a compact binary file */
+bool writeRideProfile(const std::string& filename, const RideProfile& profile);
+
+/* prints lap time and the g-force extremes */
+void printRideSummary(const RideProfile& profile);
+
+#endif
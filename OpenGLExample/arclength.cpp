@@ -0,0 +1,101 @@
+#include "arclength.h"
+#include "frenet.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+void ArcLengthTable::build(const vector<vec3>& points)
+{
+	TRACE_ZONE("ArcLengthTable::build");
+	size_t n = points.size();
+	s.resize(n + 1);
+	height.resize(n + 1);
+	curvature.resize(n + 1);
+
+	s[0] = 0.0f;
+	for(size_t i = 0; i < n; i++)
+	{
+		vec3 prevPos = points[(i + n - 1) % n];
+		vec3 nextPos = points[(i + 1) % n];
+		float r = radiusOfCurvature(nextPos, points[i], prevPos);
+
+		s[i + 1] = s[i] + getLength(nextPos - points[i]);
+		height[i] = points[i].y;
+		curvature[i] = (r > 0.0f) ? 1.0f / r : 0.0f;
+	}
+	height[n] = height[0];
+	curvature[n] = curvature[0];
+	total = s[n];
+}
+
+void ArcLengthTable::update(const vector<vec3>& points, int first, int count)
+{
+	int n = points.size();
+	if(n + 1 != (int)s.size() || count >= n)
+	{
+		build(points);
+		return;
+	}
+
+	/* height and curvature only change on the moved points and their neighbours*/
+	for(int k = -1; k <= count; k++)
+	{
+		int i = ((first + k) % n + n) % n;
+		vec3 prevPos = points[(i + n - 1) % n];
+		vec3 nextPos = points[(i + 1) % n];
+		float r = radiusOfCurvature(nextPos, points[i], prevPos);
+
+		height[i] = points[i].y;
+		curvature[i] = (r > 0.0f) ? 1.0f / r : 0.0f;
+	}
+	height[n] = height[0];
+	curvature[n] = curvature[0];
+
+	/* distances shift for everything after the first moved segment*/
+	int from = (first + count > n) ? 0 : std::max(first - 1, 0);
+	for(int i = from; i < n; i++)
+		s[i + 1] = s[i] + getLength(points[(i + 1) % n] - points[i]);
+	total = s[n];
+}
+
+float ArcLengthTable::wrapDistance(float d) const
+{
+	if(total <= 0.0f)
+		return 0.0f;
+
+	d = fmod(d, total);
+	return (d < 0.0f) ? d + total : d;
+}
+
+int ArcLengthTable::indexAt(float d) const
+{
+	d = wrapDistance(d);
+	int i = int(upper_bound(s.begin(), s.end(), d) - s.begin()) - 1;
+	return std::min(std::max(i, 0), int(s.size()) - 2);
+}
+
+float ArcLengthTable::heightAt(float d) const
+{
+	int i = indexAt(d);
+	float len = s[i + 1] - s[i];
+	float t = (len > 0.0f) ? (wrapDistance(d) - s[i]) / len : 0.0f;
+	return height[i] + t*(height[i + 1] - height[i]);
+}
+
+float ArcLengthTable::slopeAt(float d) const
+{
+	int i = indexAt(d);
+	float len = s[i + 1] - s[i];
+	return (len > 0.0f) ? (height[i + 1] - height[i]) / len : 0.0f;
+}
+
+float ArcLengthTable::curvatureAt(float d) const
+{
+	int i = indexAt(d);
+	float len = s[i + 1] - s[i];
+	float t = (len > 0.0f) ? (wrapDistance(d) - s[i]) / len : 0.0f;
+	return curvature[i] + t*(curvature[i + 1] - curvature[i]);
+}
@@ -0,0 +1,33 @@
+#ifndef ARCLENGTH_H
+#define ARCLENGTH_H
+
+#include "glm/glm.hpp"
+#include <vector>
+
+using namespace glm;
+
+/* Arc length parameterisation of a closed curve. Entry i holds the distance travelled from
+ * points[0] to points[i], with one extra entry closing the loop back at points[0]. */
+struct ArcLengthTable{
+	std::vector<float> s;
+	std::vector<float> height;
+	std::vector<float> curvature;	//physical curvature 1/r, 0 on straight sections
+	float total;
+
+	ArcLengthTable(): total(0.0f){}
+
+	void build(const std::vector<vec3>& points);
+	/* after points[first] to points[first + count - 1] moved, wrapping past the end */
+	void update(const std::vector<vec3>& points, int first, int count);
+
+	/* wraps any distance into [0, total) */
+	float wrapDistance(float d) const;
+	/* index of the point at or before distance d along the curve */
+	int indexAt(float d) const;
+
+	float heightAt(float d) const;
+	float slopeAt(float d) const;		//dh/ds
+	float curvatureAt(float d) const;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "arena.h"
+
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <algorithm>
+
+using namespace std;
+
+static size_t roundUp(size_t bytes)
+{
+	return (bytes + BakeArena::alignment - 1)/BakeArena::alignment*BakeArena::alignment;
+}
+
+void BakeArena::addBlock(size_t bytes)
+{
+	Block block;
+	block.size = roundUp(std::max(bytes, (size_t)alignment));
+	block.used = 0;
+	block.allocation = (char*)malloc(block.size + alignment - 1);
+	if(!block.allocation)
+		throw bad_alloc();
+	block.data = (char*)(((uintptr_t)block.allocation + alignment - 1)/alignment*alignment);
+	blocks.push_back(block);
+}
+
+void BakeArena::reserve(size_t bytes)
+{
+	bytes = roundUp(bytes);
+	if(!blocks.empty() && (blocks[0].size >= bytes || used() > 0))
+		return;
+	release();
+	addBlock(bytes);
+}
+
+void* BakeArena::allocateBytes(size_t bytes)
+{
+	bytes = roundUp(bytes);
+	if(blocks.empty() || blocks.back().size - blocks.back().used < bytes)
+	{
+		/* the bake outgrew what was reserved, carry on in a new block at least as big again*/
+		addBlock(std::max(bytes, capacity()));
+	}
+
+	Block& block = blocks.back();
+	void* span = block.data + block.used;
+	block.used += bytes;
+	highWater = std::max(highWater, used());
+	return span;
+}
+
+BakeArena::Mark BakeArena::mark() const
+{
+	Mark m;
+	m.block = blocks.size();
+	m.used = blocks.empty() ? 0 : blocks.back().used;
+	return m;
+}
+
+void BakeArena::rewind(const Mark& m)
+{
+	/* blocks added since are kept for reset() to merge, only emptied*/
+	for(size_t b = m.block; b < blocks.size(); b++)
+		blocks[b].used = 0;
+	if(m.block > 0)
+		blocks[m.block - 1].used = m.used;
+}
+
+void BakeArena::reset()
+{
+	if(blocks.size() > 1)
+	{
+		size_t total = capacity();
+		release();
+		addBlock(total);
+	}
+	else if(!blocks.empty())
+		blocks[0].used = 0;
+}
+
+void BakeArena::release()
+{
+	for(size_t b = 0; b < blocks.size(); b++)
+		free(blocks[b].allocation);
+	blocks.clear();
+}
+
+size_t BakeArena::used() const
+{
+	size_t total = 0;
+	for(size_t b = 0; b < blocks.size(); b++)
+		total += blocks[b].used;
+	return total;
+}
+
+size_t BakeArena::capacity() const
+{
+	size_t total = 0;
+	for(size_t b = 0; b < blocks.size(); b++)
+		total += blocks[b].size;
+	return total;
+}
+
+BakeArena& threadArena()
+{
+	static thread_local BakeArena arena;
+	return arena;
+}
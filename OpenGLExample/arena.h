@@ -0,0 +1,68 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <cstddef>
+
+/* A monotonic arena for the scratch arrays of a bake. Spans are handed out back to back,
+ * each starting on a cache line, and never freed one by one: reset() gives them all back
+ * at once and keeps the memory for the next bake, so baking the same track again takes
+ * nothing new from the heap. Nothing is constructed or destroyed, only trivially
+ * copyable types such as vec3, mat3 and float belong in it. */
+class BakeArena{
+public:
+	static const size_t alignment = 64;
+
+	/* where the arena had got to, to hand back what a function used on its way out */
+	struct Mark{
+		size_t block, used;
+	};
+
+	BakeArena(): highWater(0){}
+	~BakeArena() { release(); }
+
+	/* makes the first block hold at least bytes, call while the arena is empty */
+	void reserve(size_t bytes);
+
+	template<class T> T* allocate(size_t count) { return static_cast<T*>(allocateBytes(count*sizeof(T))); }
+	void* allocateBytes(size_t bytes);
+
+	Mark mark() const;
+	void rewind(const Mark& mark);
+
+	/* every span is gone. Blocks added when the first ran out are merged into one for next time */
+	void reset();
+	void release();
+
+	size_t used() const;
+	size_t capacity() const;
+	size_t peak() const { return highWater; }
+
+private:
+	struct Block{
+		char* allocation;	//as malloc returned it
+		char* data;			//the first cache line boundary in it
+		size_t size, used;
+	};
+
+	void addBlock(size_t bytes);
+
+	std::vector<Block> blocks;
+	size_t highWater;
+};
+
+/* the calling thread's arena, each bake thread reuses its own */
+BakeArena& threadArena();
+
+/* rewinds the arena to where it was when the scope began */
+class ArenaScope{
+public:
+	explicit ArenaScope(BakeArena& _arena): arena(_arena), start(_arena.mark()){}
+	~ArenaScope() { arena.rewind(start); }
+
+private:
+	BakeArena& arena;
+	BakeArena::Mark start;
+};
+
+#endif
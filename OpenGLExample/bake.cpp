@@ -0,0 +1,452 @@
+#include "bake.h"
+#include "frenet.h"
+#include "frenet_batch.h"
+#include "supports.h"
+#include "trace.h"
+#include "arena.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+/* the same wrapping as wrap() in main.cpp, for a curve of n points*/
+static inline int wrapIndex(int i, int n)
+{
+	return (i >= 0) ? i % n : n - 1;
+}
+
+/* length of the curve from point from to point to + 1*/
+static float runLength(const vector<vec3>& points, int from, int to)
+{
+	int n = points.size();
+	float total = 0;
+	for(int i = from; i <= to; i++)
+		total += getLength(points[wrapIndex(i + 1, n)] - points[wrapIndex(i, n)]);
+
+	return total;
+}
+
+static const char* sectionNames[] = {"lift", "free", "brake", "station"};
+
+const char* sectionName(SectionType section)
+{
+	return (section < SECTION_UNTAGGED) ? sectionNames[section] : "";
+}
+
+bool parseSectionName(const string& name, SectionType* section)
+{
+	for(int s = 0; s < SECTION_UNTAGGED; s++)
+	{
+		if(name == sectionNames[s])
+		{
+			*section = (SectionType)s;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool readTrackFile(const string& filename, vector<vec3>* points, vector<SectionType>* tags)
+{
+	TRACE_ZONE("readTrackFile");
+	ifstream myFile(filename.c_str());
+	if(!myFile.is_open())
+	{
+		cout << "Could not open track file " << filename << endl;
+		return false;
+	}
+
+	points->clear();
+	tags->clear();
+	string line;
+	int lineNumber = 0;
+	while(getline(myFile, line))
+	{
+		lineNumber++;
+		istringstream fields(line);
+		float x, y, z;
+		if(!(fields >> x >> y >> z))
+			continue;
+
+		SectionType tag = SECTION_UNTAGGED;
+		string name;
+		if(fields >> name && !parseSectionName(name, &tag))
+			cout << filename << ":" << lineNumber << ": unknown section " << name << ", ignored" << endl;
+
+		points->push_back(vec3(x, y, z));
+		tags->push_back(tag);
+	}
+
+	return !points->empty();
+}
+
+void subdivideCurve(const vec3* points, size_t n, vec3* out)
+{
+	TRACE_ZONE("subdivideCurve");
+
+	/* splitting puts the midpoint of each edge after its first point, averaging each split
+	 * point with the next. Both in one pass, the split points are never stored*/
+	for(size_t i = 0; i < n; i++)
+	{
+		vec3 next = points[(i + 1) % n];
+		vec3 midpoint = 0.5f*(points[i] + next);
+		out[2*i] = 0.5f*(points[i] + midpoint);
+		out[2*i + 1] = 0.5f*(midpoint + next);
+	}
+}
+
+vector<vec3> subdivideCurve(const vector<vec3>& points)
+{
+	vector<vec3> averagedPoints(2*points.size());
+	if(!points.empty())
+		subdivideCurve(&points[0], points.size(), &averagedPoints[0]);
+	return averagedPoints;
+}
+
+void subdivideCurve(const vector<vec3>& points, int levels, vector<vec3>* curve)
+{
+	size_t n = points.size();
+	size_t finalSize = n << levels;
+	if(n == 0 || levels == 0)
+	{
+		*curve = points;
+		return;
+	}
+
+	/* the passes go back and forth between two spans of the final size*/
+	BakeArena& arena = threadArena();
+	ArenaScope scope(arena);
+	vec3* spans[2] = {arena.allocate<vec3>(finalSize), arena.allocate<vec3>(finalSize)};
+	copy(points.begin(), points.end(), spans[0]);
+	for(int l = 0; l < levels; l++, n *= 2)
+		subdivideCurve(spans[l%2], n, spans[(l + 1)%2]);
+	curve->assign(spans[levels%2], spans[levels%2] + finalSize);
+}
+
+/* the lift, free and brake runs worked out from the heights of an untagged track. Heights
+ * are compared within a small fraction of the track's height range, a subdivided curve is
+ * rarely exactly flat*/
+static void inferSections(const vector<vec3>& points, vector<unsigned char>* pointSections)
+{
+	int n = points.size();
+	float highest = points[0].y, lowest = points[0].y;
+	int highestIndex = 0, lowestIndex = 0;
+	for(int i = 0; i < n; i++)
+	{
+		if(highest < points[i].y)
+		{
+			highest = points[i].y;
+			highestIndex = i;
+		}
+		if(lowest > points[i].y)
+		{
+			lowest = points[i].y;
+			lowestIndex = i;
+		}
+	}
+
+	float low = lowest + std::max(1e-4f*(highest - lowest), 1e-6f);
+	const float flatGradient = 1e-3f;
+
+	/* the lift starts where the curve climbs away from the lowest height, the brakes where
+	 * it first runs flat at that height, or at the lowest point if it never does*/
+	int startPoint = lowestIndex;
+	for(int i = 0; i < n; i++)
+	{
+		vec3 step = points[wrapIndex(i + 1, n)] - points[i];
+		if(points[i].y <= low && step.y > flatGradient*getLength(step))
+		{
+			startPoint = i;
+			break;
+		}
+	}
+
+	int startDec = lowestIndex;
+	for(int i = 0; i < n; i++)
+	{
+		vec3 step = points[wrapIndex(i + 1, n)] - points[i];
+		if(points[i].y <= low && std::abs(step.y) <= flatGradient*getLength(step))
+		{
+			startDec = i;
+			break;
+		}
+	}
+
+	/* round the lap from the lift: up to the top, free to the brakes, brakes back to the lift*/
+	SectionType section = SECTION_LIFT;
+	for(int k = 0; k < n; k++)
+	{
+		int i = wrapIndex(startPoint + k, n);
+		if(section == SECTION_FREE && i == startDec)
+			section = SECTION_BRAKE;
+
+		(*pointSections)[i] = section;
+		if(section == SECTION_LIFT && i == highestIndex)
+			section = SECTION_FREE;
+	}
+}
+
+vector<unsigned char> assignSections(const vector<vec3>& curve, const vector<SectionType>& tags, int levels)
+{
+	TRACE_ZONE("assignSections");
+	int n = curve.size();
+	int controls = tags.size();
+	vector<unsigned char> pointSections(n, SECTION_FREE);
+	if(n == 0)
+		return pointSections;
+
+	/* untagged points carry on the section of the tagged point before them, round the loop*/
+	int last = -1;
+	for(int c = 0; c < controls; c++)
+	{
+		if(tags[c] != SECTION_UNTAGGED)
+			last = c;
+	}
+	if(last < 0 || controls << levels != n)
+	{
+		inferSections(curve, &pointSections);
+		return pointSections;
+	}
+
+	vector<SectionType> resolved(controls);
+	SectionType current = tags[last];
+	for(int c = 0; c < controls; c++)
+	{
+		if(tags[c] != SECTION_UNTAGGED)
+			current = tags[c];
+		resolved[c] = current;
+	}
+
+	/* every subdivision doubles the points, the points of level levels from 2^levels*c
+	 * on lie along the control polygon's edge from point c*/
+	for(int k = 0; k < n; k++)
+		pointSections[k] = resolved[k >> levels];
+
+	return pointSections;
+}
+
+TrackSections findSections(const vector<vec3>& points, const vector<unsigned char>& pointSections)
+{
+	TRACE_ZONE("findSections");
+	TrackSections sections;
+	int n = points.size();
+	if(n == 0)
+		return sections;
+
+	sections.highest = sections.lowest = points[0].y;
+	for(int i = 0; i < n; i++)
+	{
+		if(sections.highest < points[i].y)
+		{
+			sections.highest = points[i].y;
+			sections.highestIndex = i;
+		}
+		if(sections.lowest > points[i].y)
+		{
+			sections.lowest = points[i].y;
+			sections.lowestIndex = i;
+		}
+	}
+
+	/* the lap starts at the bottom of the first lift, or at the lowest point without one*/
+	sections.startPoint = sections.lowestIndex;
+	for(int i = 0; i < n; i++)
+	{
+		if(pointSections[i] == SECTION_LIFT && pointSections[wrapIndex(i - 1, n)] != SECTION_LIFT)
+		{
+			sections.startPoint = i;
+			break;
+		}
+	}
+
+	/* the brake run is the first one after the start*/
+	sections.startDec = sections.lowestIndex;
+	for(int k = 0; k < n; k++)
+	{
+		int i = wrapIndex(sections.startPoint + k, n);
+		if(pointSections[i] == SECTION_BRAKE)
+		{
+			sections.startDec = i;
+			break;
+		}
+	}
+
+	int end = sections.startDec;
+	while(pointSections[wrapIndex(end + 1, n)] == SECTION_BRAKE && wrapIndex(end + 1, n) != sections.startDec)
+		end = wrapIndex(end + 1, n);
+	sections.decDist = (pointSections[sections.startDec] == SECTION_BRAKE) ?
+		runLength(points, sections.startDec, (end < sections.startDec) ? end + n : end) : 0.0f;
+	return sections;
+}
+
+/* length of the run of section from point i on*/
+static float sectionLength(const vector<vec3>& points, const vector<unsigned char>& pointSections, int i)
+{
+	int n = points.size();
+	float total = 0;
+	for(int k = 0; k < n && pointSections[wrapIndex(i + k, n)] == pointSections[i]; k++)
+		total += getLength(points[wrapIndex(i + k + 1, n)] - points[wrapIndex(i + k, n)]);
+
+	return total;
+}
+
+vector<float> designSpeeds(const vector<vec3>& points, const vector<unsigned char>& pointSections,
+						const TrackSections& sections, const BakeSettings& settings)
+{
+	TRACE_ZONE("designSpeeds");
+	int n = points.size();
+	vector<float> speeds(n);
+	if(n == 0)
+		return speeds;
+
+	/* once round the lap from the start, each point's speed from the one before and the
+	 * model of its section. Gravity acts everywhere, the chain and the brakes on top of it*/
+	float g = -settings.gravity.y;
+	float v = (pointSections[sections.startPoint] == SECTION_LIFT) ? settings.liftSpeed : settings.stationSpeed;
+	float brakeRate = settings.brakeRate;
+	for(int k = 0; k < n; k++)
+	{
+		int i = wrapIndex(sections.startPoint + k, n);
+		int prev = wrapIndex(i - 1, n);
+		float ds = getLength(points[i] - points[prev]);
+		SectionType section = (SectionType)pointSections[i];
+
+		/* coasting from the previous point*/
+		float coast = (k == 0) ? v : sqrt(std::max(v*v + 2.0f*g*(points[prev].y - points[i].y), 0.0f));
+
+		switch(section)
+		{
+		case SECTION_LIFT:
+			/* the chain pulls the cart up at its own speed, a faster cart runs over it*/
+			v = std::max(settings.liftSpeed, coast);
+			break;
+
+		case SECTION_BRAKE:
+			/* eddy current brakes, the force is proportional to speed so the speed falls by
+			 * the same amount every metre. Unset, the rate brings the cart down to the station
+			 * speed by the end of the run*/
+			if(pointSections[prev] != SECTION_BRAKE && settings.brakeRate <= 0.0f)
+			{
+				float length = sectionLength(points, pointSections, i);
+				brakeRate = (length > 0.0f) ? std::max(coast - settings.stationSpeed, 0.0f)/length : 0.0f;
+			}
+			v = (coast > settings.stationSpeed) ? std::max(coast - brakeRate*ds, settings.stationSpeed) : coast;
+			break;
+
+		case SECTION_STATION:
+			v = settings.stationSpeed;
+			break;
+
+		default:
+			v = coast;
+			break;
+		}
+
+		speeds[i] = v;
+	}
+
+	return speeds;
+}
+
+void bakeRails(const vector<vec3>& curve, const vector<float>& speeds, vec3 gravity,
+			int first, int count, vector<mat3>* frames, vector<vec3>* posRail, vector<vec3>* negRail,
+			vector<vec3>* ties)
+{
+	TRACE_ZONE("bakeRails");
+	int n = curve.size();
+
+	/* the frames in one batch, at the design speed of each point*/
+	BakeArena& arena = threadArena();
+	ArenaScope scope(arena);
+	float* spanSpeeds = arena.allocate<float>(count);
+	for(int k = 0; k < count; k++)
+		spanSpeeds[k] = speeds[wrapIndex(first + k, n)];
+
+	CurveSoA span;
+	FrameSoA spanFrames;
+	span.buildSpan(curve, wrapIndex(first, n), count);
+	frenetFramesBatch(span, spanSpeeds, gravity, &spanFrames);
+
+	/* the binormal added to the curve for one rail and subtracted for the other*/
+	for(int k = 0; k < count; k++)
+	{
+		int j = wrapIndex(first + k, n);
+		(*frames)[j] = mat3(spanFrames.B.get(k), spanFrames.N.get(k), spanFrames.T.get(k));
+		vec3 binormal = spanFrames.B.get(k)*railOffset;
+
+		(*negRail)[j] = curve[j] - binormal;
+		(*posRail)[j] = curve[j] + binormal;
+
+		if(j%2 == 0)
+		{
+			(*ties)[j] = curve[j] - binormal;
+			(*ties)[j + 1] = curve[j] + binormal;
+		}
+	}
+}
+
+bool bakeTrack(const vector<vec3>& control, const vector<SectionType>& tags, const BakeSettings& settings,
+				TrackBake* bake, const BakeProgress& progress)
+{
+	TRACE_ZONE("bakeTrack");
+	if(control.size() < 3)
+		return false;
+
+	/* the scratch of the last bake on this thread goes in one go, its memory is kept for this
+	 * one. Every size follows from the final point count*/
+	size_t finalSize = control.size() << settings.levels;
+	BakeArena& arena = threadArena();
+	arena.reset();
+	arena.reserve(2*finalSize*sizeof(vec3) + finalSize*sizeof(float) + 4*BakeArena::alignment);
+
+	bake->control = control;
+	bake->tags = tags;
+	bake->tags.resize(control.size(), SECTION_UNTAGGED);
+	bake->curve.reserve(finalSize);
+	bake->curve = control;
+	bake->supports.clear();
+	if(progress)
+		progress(BAKE_CONTROL, *bake);
+
+	/* each level is handed on as it is done, so the passes run between arena spans and
+	 * the curve, which never grows past the space reserved for it*/
+	{
+		ArenaScope scope(arena);
+		vec3* spans[2] = {arena.allocate<vec3>(finalSize), arena.allocate<vec3>(finalSize)};
+		size_t n = control.size();
+		copy(control.begin(), control.end(), spans[0]);
+		for(int l = 0; l < settings.levels; l++, n *= 2)
+		{
+			subdivideCurve(spans[l%2], n, spans[(l + 1)%2]);
+			bake->curve.assign(spans[(l + 1)%2], spans[(l + 1)%2] + 2*n);
+			if(progress)
+				progress(BAKE_LEVEL, *bake);
+		}
+	}
+
+	const vector<vec3>& curve = bake->curve;
+	int n = curve.size();
+
+	bake->pointSections = assignSections(curve, bake->tags, settings.levels);
+	bake->sections = findSections(curve, bake->pointSections);
+	bake->speeds = designSpeeds(curve, bake->pointSections, bake->sections, settings);
+	bake->arc.build(curve);
+
+	bake->frames.assign(n, mat3(1.0f));
+	bake->posRail.assign(n, vec3(0.0f));
+	bake->negRail.assign(n, vec3(0.0f));
+	bake->ties.assign(n + n%2, vec3(0.0f));
+	bakeRails(curve, bake->speeds, settings.gravity, 0, n, &bake->frames, &bake->posRail, &bake->negRail, &bake->ties);
+	bake->lap.build(curve, bake->frames, bake->speeds, bake->arc, settings.lapSpacing);
+	if(progress)
+		progress(BAKE_RAILS, *bake);
+
+	generateSupports(curve, settings.supportSpacing, settings.groundHeight, settings.supportWidth, &bake->supports);
+	if(progress)
+		progress(BAKE_SUPPORTS, *bake);
+	return true;
+}
@@ -0,0 +1,116 @@
+#ifndef BAKE_H
+#define BAKE_H
+
+#include "glm/glm.hpp"
+#include "arclength.h"
+#include "laptable.h"
+#include <vector>
+#include <string>
+#include <functional>
+
+using namespace glm;
+
+/* Everything the track is built from its control points. None of it touches GL or the
+ * globals in main.cpp, so a track can be baked on a worker thread while the old one renders. */
+
+struct BakeSettings{
+	int levels;				//subdivision passes
+	vec3 gravity;
+	float liftSpeed;		//chain speed up the lift hill
+	float brakeRate;		//speed the magnetic brakes take off per metre (1/s), 0 to stop at the station
+	float stationSpeed;		//speed through the station, the brakes let go at it
+	float lapSpacing;		//arc length between samples of the lap table
+	float supportSpacing;	//arc length between supports
+	float groundHeight;
+	float supportWidth;
+
+	BakeSettings(): levels(10), gravity(0.0f, -9.81f, 0.0f), liftSpeed(2.9f), brakeRate(0.0f),
+					stationSpeed(1.0f), lapSpacing(0.05f), supportSpacing(8.0f), groundHeight(-3.0f), supportWidth(0.75f){}
+};
+
+/* What moves the cart along a stretch of track. A track file point may end with one of
+ * lift, free, brake or station, which holds from that point until the next tagged one */
+enum SectionType{
+	SECTION_LIFT = 0,	//a chain pulls the cart up at liftSpeed, it coasts if faster
+	SECTION_FREE,		//gravity only
+	SECTION_BRAKE,		//magnetic brakes, force proportional to speed
+	SECTION_STATION,	//rolls through at stationSpeed
+	SECTION_UNTAGGED	//same as the point before
+};
+
+const char* sectionName(SectionType section);
+/* false if name is not one of the section names */
+bool parseSectionName(const std::string& name, SectionType* section);
+
+/* heights of the curve and where the lap starts and brakes, from the sections */
+struct TrackSections{
+	float highest, lowest;
+	int highestIndex, lowestIndex;
+	int startPoint;		//bottom of the lift hill
+	int startDec;		//start of the brake run
+	float decDist;		//length of the brake run
+
+	TrackSections(): highest(0.0f), lowest(0.0f), highestIndex(0), lowestIndex(0),
+					startPoint(0), startDec(0), decDist(0.0f){}
+};
+
+struct TrackBake{
+	std::vector<vec3> control;		//the track file's points
+	std::vector<SectionType> tags;	//the track file's section of each control point
+	std::vector<vec3> curve;		//control subdivided
+	TrackSections sections;
+	std::vector<unsigned char> pointSections;	//SectionType of each point of curve
+	std::vector<float> speeds;		//design speed at each point of curve
+	std::vector<mat3> frames;		//Frenet frame at each point of curve, columns B, N, T like freFrame()
+	ArcLengthTable arc;
+	LapTable lap;					//the cart's pose round the lap, from the frames and speeds
+	std::vector<vec3> posRail, negRail, ties;
+	std::vector<mat4> supports;
+};
+
+/* reads one x y z point per line, optionally followed by a section name. Returns false if the
+ * file can't be opened or has no points. tags gets SECTION_UNTAGGED for points without one */
+bool readTrackFile(const std::string& filename, std::vector<vec3>* points, std::vector<SectionType>* tags);
+
+/* one split and average pass over a closed curve, out holds 2n points */
+void subdivideCurve(const vec3* points, size_t n, vec3* out);
+std::vector<vec3> subdivideCurve(const std::vector<vec3>& points);
+/* levels passes, through the thread's arena, allocating curve once at its final size */
+void subdivideCurve(const std::vector<vec3>& points, int levels, std::vector<vec3>* curve);
+
+/* section of every point of a curve subdivided levels times from control points with tags.
+ * Without any tags, the lift runs from the bottom of the climb to the highest point, the brakes
+ * from where the track first runs flat at its lowest back to the lift */
+std::vector<unsigned char> assignSections(const std::vector<vec3>& curve, const std::vector<SectionType>& tags,
+										int levels);
+
+TrackSections findSections(const std::vector<vec3>& points, const std::vector<unsigned char>& pointSections);
+
+/* one lap from the start point with the chain lift, gravity, magnetic brake and station models */
+std::vector<float> designSpeeds(const std::vector<vec3>& points, const std::vector<unsigned char>& pointSections,
+								const TrackSections& sections, const BakeSettings& settings);
+
+/* distance from the centreline to each rail, along the binormal */
+const float railOffset = 1.5f;
+
+/* frames, rails and ties for count points of curve from first on, which may wrap past the end.
+ * The arrays must already be sized, ties[j] and ties[j+1] hold the tie at every even j */
+void bakeRails(const std::vector<vec3>& curve, const std::vector<float>& speeds, vec3 gravity,
+				int first, int count, std::vector<mat3>* frames, std::vector<vec3>* posRail,
+				std::vector<vec3>* negRail, std::vector<vec3>* ties);
+
+enum BakeStage{
+	BAKE_CONTROL = 0,	//curve is still the control polygon
+	BAKE_LEVEL,			//curve is one subdivision level finer
+	BAKE_RAILS,			//sections, speeds, arc length table, frames and rails are done
+	BAKE_SUPPORTS		//supports are placed, the bake is complete
+};
+
+/* called with the bake so far after each stage, from the thread doing the bake */
+typedef std::function<void(BakeStage, const TrackBake&)> BakeProgress;
+
+/* the whole track from its control points and their section tags, returns false for fewer than 3 points */
+bool bakeTrack(const std::vector<vec3>& control, const std::vector<SectionType>& tags, const BakeSettings& settings,
+				TrackBake* bake, const BakeProgress& progress = BakeProgress());
+
+#endif
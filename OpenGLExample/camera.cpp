@@ -1,83 +1,83 @@
 #include "camera.h"
 
-mat4 rotateAbout(vec3 axis, float radians)
+/* the rotation taking the camera's axes to right, up and back (-dir)*/
+static quat basisRotation(vec3 right, vec3 up, vec3 back)
 {
-	mat4 matrix;
-/*
-	matrix[0][0] = cos(radians) + axis.x*axis.x*(1-cos(radians));
-	matrix[1][0] = axis.x*axis.y*(1-cos(radians))-axis.z*sin(radians);
-	matrix[2][0] = axis.x*axis.z*(1-cos(radians)) + axis.y*sin(radians);
-
-	matrix[0][1] = axis.y*axis.x*(1-cos(radians)) + axis.z*sin(radians);
-	matrix[1][1] = cos(radians) + axis.y*axis.y*(1-cos(radians));
-	matrix[2][1] = axis.y*axis.z*(1-cos(radians)) - axis.x*sin(radians);
+	return normalize(quat_cast(mat3(right, up, back)));
+}
 
-	matrix[0][2] = axis.z*axis.x*(1-cos(radians)) - axis.y*sin(radians);
-	matrix[1][2] = axis.z*axis.y*(1-cos(radians)) + axis.x*sin(radians);
-	matrix[2][2] = cos(radians) + axis.z*axis.z*(1-cos(radians));
-*/
+Camera::Camera(): pos(vec3(0, 0, 1.f)), projection(1.0f), dirty(true)
+{
+	orientation = quat(1.0f, 0.0f, 0.0f, 0.0f);
+}
 
-	matrix[0][0] = cos(radians) + axis.x*axis.x*(1-cos(radians));
-	matrix[0][1] = axis.x*axis.y*(1-cos(radians))-axis.z*sin(radians);
-	matrix[0][2] = axis.x*axis.z*(1-cos(radians)) + axis.y*sin(radians);
+Camera::Camera(vec3 _dir, vec3 _pos): pos(_pos), projection(1.0f), dirty(true)
+{
+	place(_pos, _dir, vec3(0, 1, 0));
+}
 
-	matrix[1][0] = axis.y*axis.x*(1-cos(radians)) + axis.z*sin(radians);
-	matrix[1][1] = cos(radians) + axis.y*axis.y*(1-cos(radians));
-	matrix[1][2] = axis.y*axis.z*(1-cos(radians)) - axis.x*sin(radians);
+void Camera::place(vec3 _pos, vec3 _dir, vec3 _up)
+{
+	vec3 back = -normalize(_dir);
+	vec3 newRight = normalize(cross(_up, back));
+	orientation = basisRotation(newRight, cross(back, newRight), back);
+	pos = _pos;
+	dirty = true;
+}
 
-	matrix[2][0] = axis.z*axis.x*(1-cos(radians)) - axis.y*sin(radians);
-	matrix[2][1] = axis.z*axis.y*(1-cos(radians)) + axis.x*sin(radians);
-	matrix[2][2] = cos(radians) + axis.z*axis.z*(1-cos(radians));
-	
-	return matrix;
+void Camera::setProjection(const mat4& _projection)
+{
+	if(_projection == projection)
+		return;
+	projection = _projection;
+	dirty = true;
 }
 
+/* orbits the origin about the camera's right axis*/
 void Camera::trackballUp(float radians)
 {
-	mat4 rotation = rotateAbout(right, -radians);
-
-	vec4 newPos = rotation*vec4(pos, 1);
-	pos = vec3(newPos.x, newPos.y, newPos.z);
-
-	vec4 newUp = rotation*vec4(up, 1);
-	up = normalize(vec3(newUp.x, newUp.y, newUp.z));
-
-	vec4 newDir = rotation*vec4(dir, 1);
-	dir = normalize(vec3(newDir.x, newDir.y, newDir.z));
+	refresh();
+	quat rotation = angleAxis(radians, right);
+	pos = rotation*pos;
+	orientation = normalize(rotation*orientation);
+	dirty = true;
 }
 
+/* orbits the origin about the camera's up axis*/
 void Camera::trackballRight(float radians)
 {
-	mat4 rotation = rotateAbout(up, radians);
-
-	vec4 newPos = rotation*vec4(pos, 1);
-	pos = vec3(newPos.x, newPos.y, newPos.z);
-
-	vec4 newRight = rotation*vec4(right, 1);
-	right = normalize(vec3(newRight.x, newRight.y, newRight.z));
-
-	vec4 newDir = rotation*vec4(dir, 1);
-	dir = normalize(vec3(newDir.x, newDir.y, newDir.z));
+	refresh();
+	quat rotation = angleAxis(-radians, up);
+	pos = rotation*pos;
+	orientation = normalize(rotation*orientation);
+	dirty = true;
 }
 
 void Camera::zoom(float factor)
 {
+	refresh();
 	pos = -dir*length(pos)*factor;
+	dirty = true;
 }
 
-mat4 Camera::getMatrix()
+void Camera::refresh() const
 {
-	mat4 cameraRotation = mat4(
-			vec4(right, 0),
-			vec4(up, 0),
-			vec4(-dir, 0),
-			vec4(0, 0, 0, 1));
+	if(!dirty)
+		return;
+
+	mat3 rotation = mat3_cast(orientation);
+	right = rotation[0];
+	up = rotation[1];
+	dir = -rotation[2];
+
+	/* the inverse of a rotation is its transpose, so neither matrix needs inverting*/
+	mat3 toCamera = transpose(rotation);
+	view = mat4(toCamera);
+	view[3] = vec4(-(toCamera*pos), 1.0f);
 
-	mat4 translation = mat4 (
-			vec4(1, 0, 0, 0),
-			vec4(0, 1, 0, 0),
-			vec4(0, 0, 1, 0),
-			vec4(-pos, 1));
+	inverseView = mat4(rotation);
+	inverseView[3] = vec4(pos, 1.0f);
 
-	return transpose(cameraRotation)*translation;
+	viewProjection = projection*view;
+	dirty = false;
 }
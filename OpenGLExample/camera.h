@@ -3,30 +3,48 @@
 
 
 #include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
 #include <cstdio>
 
 using namespace glm;
 
+/* A camera stored as a position and a unit quaternion turning the camera's axes (right,
+ * up, -dir) into world space. The view, its inverse and the view projection are only
+ * rebuilt after the camera moves or the projection changes, so asking for them again
+ * in the same frame, for culling or shadows, costs nothing. */
 class Camera{
 public:
-	vec3 dir;
-	vec3 right;
-	vec3 up;
-
-	vec3 pos;
-
-	Camera():	dir(vec3(0, 0, -1)), right(vec3(1, 0, 0)), up(vec3(0, 1, 0)), 
-				pos(vec3(0, 0, 1.f)){}
-
-	Camera(vec3 _dir, vec3 _pos):dir(_dir), pos(_pos){
-		right = normalize(cross(dir, vec3(0, 1, 0)));
-		up = normalize(cross(right, dir));
-	}
+	Camera();
+	Camera(vec3 dir, vec3 pos);
 
 	void trackballUp(float radians);
 	void trackballRight(float radians);
 	void zoom(float factor);
-	mat4 getMatrix();
+
+	/* puts the camera at pos looking along dir, up is squared to dir */
+	void place(vec3 pos, vec3 dir, vec3 up);
+	void setProjection(const mat4& projection);
+
+	vec3 getPosition() const { return pos; }
+	vec3 getDirection() const { refresh(); return dir; }
+	vec3 getRight() const { refresh(); return right; }
+	vec3 getUp() const { refresh(); return up; }
+
+	const mat4& getMatrix() const { refresh(); return view; }
+	const mat4& getInverseMatrix() const { refresh(); return inverseView; }
+	const mat4& getViewProjection() const { refresh(); return viewProjection; }
+
+private:
+	void refresh() const;
+
+	quat orientation;
+	vec3 pos;
+	mat4 projection;
+
+	/* derived from the above when dirty*/
+	mutable bool dirty;
+	mutable vec3 dir, right, up;
+	mutable mat4 view, inverseView, viewProjection;
 };
 
-#endif
\ No newline at end of file
+#endif
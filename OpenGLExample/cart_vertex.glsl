@@ -0,0 +1,65 @@
+// ==========================================================================
+// Vertex program for the carts
+//
+// Each instance is one car at its own distance round the lap. Its pose is
+// read from the baked lap table and blended between the two samples either
+// side, the model matrix places this part of the car in the car's frame
+// ==========================================================================
+#version 410
+
+// locations 0 and 1 match vertex.glsl, the per-instance distance takes 2
+layout(location = 0) in vec3 VertexPosition;
+layout(location = 1) in vec3 VertexNormal;
+layout(location = 2) in float LapDistance;
+
+uniform mat4 perspectiveMatrix;
+uniform mat4 modelviewMatrix;
+uniform mat3 normalMatrix;
+uniform vec3 worldOffset;		// added after the pose, the body rides above the rails
+
+// two texels a sample, the position and then the orientation quaternion (x, y, z, w)
+uniform samplerBuffer lapPoses;
+uniform int lapSamples;
+uniform float lapSpacing;
+
+out vec3 FragNormal;
+out vec3 WorldPosition;
+
+// the depth prepass and the shading pass use different programs on this shader,
+// their depths must come out the same
+invariant gl_Position;
+
+// the baked frame, columns B, N, T. The quaternion holds B, N, -T
+mat3 frameOf(vec4 q)
+{
+	vec3 q2 = 2.0*q.xyz;
+	float xx = q.x*q2.x, yy = q.y*q2.y, zz = q.z*q2.z;
+	float xy = q.x*q2.y, xz = q.x*q2.z, yz = q.y*q2.z;
+	float wx = q.w*q2.x, wy = q.w*q2.y, wz = q.w*q2.z;
+
+	return mat3(vec3(1.0 - yy - zz, xy + wz, xz - wy),
+				vec3(xy - wz, 1.0 - xx - zz, yz + wx),
+				-vec3(xz + wy, yz - wx, 1.0 - xx - yy));
+}
+
+void main()
+{
+	float u = mod(LapDistance/lapSpacing, float(lapSamples));
+	int k = min(int(u), lapSamples - 1);
+	int next = (k + 1 == lapSamples) ? 0 : k + 1;
+	float t = u - float(k);
+
+	// samples are a few centimetres apart, a normalised lerp is as good as a slerp there
+	vec3 position = mix(texelFetch(lapPoses, 2*k).xyz, texelFetch(lapPoses, 2*next).xyz, t);
+	vec4 a = texelFetch(lapPoses, 2*k + 1);
+	vec4 b = texelFetch(lapPoses, 2*next + 1);
+	if(dot(a, b) < 0.0)
+		b = -b;
+	mat3 frame = frameOf(normalize(mix(a, b, t)));
+
+	FragNormal = frame*(normalMatrix*VertexNormal);
+	vec4 part = modelviewMatrix*vec4(VertexPosition, 1.0);
+	vec4 world = vec4(position + worldOffset + frame*part.xyz, 1.0);
+	WorldPosition = world.xyz;
+	gl_Position = perspectiveMatrix*world;
+}
@@ -0,0 +1,10 @@
+// ==========================================================================
+// Fragment program for depth only passes (depth prepass and shadow maps)
+//
+// Writes nothing but the depth the rasterizer already computed
+// ==========================================================================
+#version 410
+
+void main(void)
+{
+}
@@ -0,0 +1,52 @@
+#include "followcamera.h"
+
+#include <cmath>
+#include <algorithm>
+
+void FollowCamera::update(CameraMode mode, const std::vector<vec3>& curve, const std::vector<mat3>& frames,
+						int index, vec3 cartPos, float dt, Camera* camera)
+{
+	int n = curve.size();
+	if(mode == CAMERA_ORBIT || n < 2 || (int)frames.size() != n)
+		return;
+
+	/* how far the cart is from point index to the next one, by projecting onto the segment*/
+	int i = ((index % n) + n) % n;
+	int j = (i + 1) % n;
+	vec3 segment = curve[j] - curve[i];
+	float lengthSquared = dot(segment, segment);
+	float t = (lengthSquared > 0.0f) ? clamp(dot(cartPos - curve[i], segment)/lengthSquared, 0.0f, 1.0f) : 0.0f;
+
+	/* N leans with gravity, so T is off the track on slopes. The binormal is square to the
+	 * track and banks with the cart, up is square to it and to the segment*/
+	vec3 targetForward = (lengthSquared > 0.0f) ? segment/std::sqrt(lengthSquared) : forward;
+	vec3 nextB = frames[j][0];
+	if(dot(nextB, frames[i][0]) < 0.0f)
+		nextB = -nextB;
+	vec3 bank = mix(frames[i][0], nextB, t);
+	vec3 targetUp = normalize(cross(bank, targetForward));
+
+	/* keep the side of the track the camera was on, N flips where the net force does*/
+	vec3 reference = placed ? up : vec3(0.0f, 1.0f, 0.0f);
+	if(dot(targetUp, reference) < 0.0f)
+		targetUp = -targetUp;
+
+	vec3 targetEye;
+	if(mode == CAMERA_RIDE)
+		targetEye = cartPos + targetUp*rideHeight + targetForward*rideAhead;
+	else
+	{
+		targetEye = cartPos - targetForward*chaseDistance + targetUp*chaseHeight;
+		targetForward = normalize(cartPos + targetForward*2.0f - targetEye);
+	}
+
+	/* exponential easing, the same fraction of the gap closes each second whatever the frame rate*/
+	float alpha = placed ? 1.0f - std::exp(-dt/std::max(smoothing, 1e-4f)) : 1.0f;
+	eye = mix(eye, targetEye, alpha);
+	forward = normalize(mix(forward, targetForward, alpha));
+	up = normalize(mix(up, targetUp, alpha));
+	placed = true;
+
+	/* place() squares up to forward however far the smoothed vectors drift apart*/
+	camera->place(eye, forward, up);
+}
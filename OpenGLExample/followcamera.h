@@ -0,0 +1,44 @@
+#ifndef FOLLOWCAMERA_H
+#define FOLLOWCAMERA_H
+
+#include "glm/glm.hpp"
+#include "camera.h"
+#include <vector>
+
+using namespace glm;
+
+enum CameraMode{
+	CAMERA_ORBIT = 0,	//the trackball Camera
+	CAMERA_RIDE,		//in the cart, looking down the track
+	CAMERA_CHASE,		//behind and above the cart
+	CAMERA_MODE_COUNT
+};
+
+/* Places a Camera on the cart from the baked frame table, reading the frames and points
+ * either side of the cart instead of walking the track, and eases towards each new placement
+ * so the step from point to point and the flips of the frame don't show */
+class FollowCamera{
+public:
+	float smoothing;		//seconds for the camera to cover most of the way to its target
+	float rideHeight;		//eye above the cart's track point, along the frame's up
+	float rideAhead;		//and along the track
+	float chaseDistance;	//eye behind the cart
+	float chaseHeight;
+
+	FollowCamera(): smoothing(0.08f), rideHeight(1.9f), rideAhead(1.0f), chaseDistance(7.0f),
+					chaseHeight(3.0f), placed(false), eye(0.0f), forward(0.0f, 0.0f, -1.0f), up(0.0f, 1.0f, 0.0f){}
+
+	/* the next update jumps straight to the target, after a mode change or a new track */
+	void reset() { placed = false; }
+
+	/* moves camera towards the view mode asks for of a cart at cartPos, between curve points
+	 * index and index + 1. frames are the bake's, columns B, N, T. dt is the frame's step */
+	void update(CameraMode mode, const std::vector<vec3>& curve, const std::vector<mat3>& frames,
+				int index, vec3 cartPos, float dt, Camera* camera);
+
+private:
+	bool placed;
+	vec3 eye, forward, up;
+};
+
+#endif
@@ -1,19 +1,68 @@
 // ==========================================================================
-// Vertex program for barebones GLFW boilerplate
+// Fragment program for everything in the scene
 //
-// Author:  Sonny Chan, University of Calgary
-// Date:    December 2015
+// One directional light, shadowed by a static map of the whole scene and a
+// dynamic map that follows the cart. Surface constants come from the
+// Materials block, picked per draw by the material uniform
 // ==========================================================================
 #version 410
 
-// interpolated colour received from vertex stage
+#define MAX_MATERIALS 16
+
+// normal and world position interpolated from the vertex stage
+in vec3 FragNormal;
+in vec3 WorldPosition;
+
+struct Material {
+	vec4 colour;
+	vec4 surface;	// ambient, specular, shininess, 1 if lit or 0 to show the colour as is
+};
+
+layout(std140) uniform Materials {
+	Material materials[MAX_MATERIALS];
+};
+uniform int material;
+
+uniform vec3 cameraPosition;
+uniform vec3 lightDirection;
+uniform mat4 staticShadowMatrix;
+uniform mat4 dynamicShadowMatrix;
+uniform sampler2DShadow staticShadowMap;
+uniform sampler2DShadow dynamicShadowMap;
 
 // first output is mapped to the framebuffer's colour index by default
 out vec4 FragmentColour;
 
-in vec3 FragNormal;
+const float bias = 0.0015;
+
+// 1 where nothing in the map is in front of the point, 0 where something is
+float visibility(sampler2DShadow map, mat4 lightMatrix)
+{
+	vec4 light = lightMatrix*vec4(WorldPosition, 1.0);
+	vec3 coord = light.xyz/light.w*0.5 + 0.5;
+	return texture(map, vec3(coord.xy, coord.z - bias));
+}
 
 void main(void)
 {
-	FragmentColour = vec4(FragNormal, 1.0);
+	Material m = materials[material];
+	if(m.surface.w == 0.0)
+	{
+		FragmentColour = m.colour;
+		return;
+	}
+
+	vec3 normal = normalize(FragNormal);
+	vec3 toLight = -lightDirection;
+	vec3 toEye = normalize(cameraPosition - WorldPosition);
+
+	float diffuse = max(dot(normal, toLight), 0.0);
+	float specular = 0.0;
+	if(diffuse > 0.0)
+		specular = pow(max(dot(normal, normalize(toLight + toEye)), 0.0), m.surface.z);
+
+	float lit = visibility(staticShadowMap, staticShadowMatrix)*visibility(dynamicShadowMap, dynamicShadowMatrix);
+	float ambient = m.surface.x;
+	vec3 colour = m.colour.rgb*(ambient + (1.0 - ambient)*diffuse*lit) + vec3(m.surface.y*specular*lit);
+	FragmentColour = vec4(colour, 1.0);
 }
@@ -0,0 +1,334 @@
+#include "framegraph.h"
+#include "glstate.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+static bool contains(const vector<string>& list, const string& name)
+{
+	return find(list.begin(), list.end(), name) != list.end();
+}
+
+static bool drawOrder(const DrawItem& a, const DrawItem& b)
+{
+	return a.key() < b.key();
+}
+
+int FrameGraph::addPass(const string& name, const PassState& state)
+{
+	Pass pass;
+	pass.name = name;
+	pass.state = state;
+	pass.framebuffer = 0;
+	pass.width = pass.height = 0;
+	pass.clearDepth = false;
+	pass.ownViewProjection = false;
+	passes.push_back(pass);
+	return passes.size() - 1;
+}
+
+void FrameGraph::reads(int pass, const string& resource)
+{
+	passes[pass].reads.push_back(resource);
+}
+
+void FrameGraph::writes(int pass, const string& resource)
+{
+	passes[pass].writes.push_back(resource);
+}
+
+void FrameGraph::target(int pass, GLuint framebuffer, int width, int height, bool clearDepth)
+{
+	passes[pass].framebuffer = framebuffer;
+	passes[pass].width = width;
+	passes[pass].height = height;
+	passes[pass].clearDepth = clearDepth;
+}
+
+void FrameGraph::setViewProjection(int pass, const mat4& viewProjection)
+{
+	passes[pass].ownViewProjection = true;
+	passes[pass].viewProjection = viewProjection;
+}
+
+void FrameGraph::screen(int width, int height)
+{
+	screenWidth = width;
+	screenHeight = height;
+}
+
+void FrameGraph::submit(int pass, const DrawItem& draw)
+{
+	if(draw.count > 0)
+		passes[pass].draws.push_back(draw);
+}
+
+void FrameGraph::programsChanged()
+{
+	uniforms.clear();
+	glState.forgetPrograms();
+}
+
+/* a pass added later has to wait for an earlier one if it reads what that pass writes,
+ * or writes anything the earlier pass reads or writes*/
+bool FrameGraph::dependsOn(int later, int earlier) const
+{
+	const Pass& a = passes[later];
+	const Pass& b = passes[earlier];
+	for(size_t r = 0; r < a.reads.size(); r++)
+		if(contains(b.writes, a.reads[r]))
+			return true;
+	for(size_t w = 0; w < a.writes.size(); w++)
+		if(contains(b.writes, a.writes[w]) || contains(b.reads, a.writes[w]))
+			return true;
+	return false;
+}
+
+/* puts passes in dependency order into order. Of the passes free to run next, the one whose
+ * first draw uses the program the last one ended on goes first, otherwise the one added first*/
+void FrameGraph::schedule()
+{
+	int n = passes.size();
+	vector<bool>& done = scheduled;
+	done.assign(n, false);
+	order.clear();
+	GLuint lastProgram = glState.program();
+
+	for(int step = 0; step < n; step++)
+	{
+		int pick = -1;
+		for(int p = 0; p < n; p++)
+		{
+			if(done[p])
+				continue;
+
+			bool ready = true;
+			for(int q = 0; q < p && ready; q++)
+				if(!done[q] && dependsOn(p, q))
+					ready = false;
+			if(!ready)
+				continue;
+
+			if(pick < 0)
+				pick = p;
+			if(!passes[p].draws.empty() && passes[p].draws[0].program == lastProgram)
+			{
+				pick = p;
+				break;
+			}
+		}
+
+		done[pick] = true;
+		order.push_back(pick);
+		if(!passes[pick].draws.empty())
+			lastProgram = passes[pick].draws.back().program;
+	}
+}
+
+/* stable, for draws of the same key keep the order they were submitted in. A pass holds
+ * a few draws mostly in order already, and unlike stable_sort this takes no buffer*/
+void FrameGraph::sortDraws(vector<DrawItem>& draws) const
+{
+	for(size_t d = 1; d < draws.size(); d++)
+	{
+		if(!drawOrder(draws[d], draws[d - 1]))
+			continue;
+		DrawItem moving = draws[d];
+		size_t to = d;
+		for(; to > 0 && drawOrder(moving, draws[to - 1]); to--)
+			draws[to] = draws[to - 1];
+		draws[to] = moving;
+	}
+}
+
+void FrameGraph::applyState(const PassState& state)
+{
+	if(!stateKnown || state.depthTest != current.depthTest)
+	{
+		if(state.depthTest)
+			glEnable(GL_DEPTH_TEST);
+		else
+			glDisable(GL_DEPTH_TEST);
+		totals.stateChanges++;
+	}
+	if(!stateKnown || state.depthWrite != current.depthWrite)
+	{
+		glDepthMask(state.depthWrite ? GL_TRUE : GL_FALSE);
+		totals.stateChanges++;
+	}
+	if(!stateKnown || state.colourWrite != current.colourWrite)
+	{
+		GLboolean c = state.colourWrite ? GL_TRUE : GL_FALSE;
+		glColorMask(c, c, c, c);
+		totals.stateChanges++;
+	}
+	if(!stateKnown || state.depthFunc != current.depthFunc)
+	{
+		glDepthFunc(state.depthFunc);
+		totals.stateChanges++;
+	}
+
+	current = state;
+	stateKnown = true;
+}
+
+/* binds the pass's framebuffer and sets the viewport to fit it, when it isn't already*/
+void FrameGraph::bindTarget(const Pass& pass)
+{
+	if(pass.framebuffer == boundFramebuffer)
+		return;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+	if(pass.framebuffer)
+		glState.viewport(0, 0, pass.width, pass.height);
+	else
+		glState.viewport(0, 0, screenWidth, screenHeight);
+	boundFramebuffer = pass.framebuffer;
+	totals.stateChanges++;
+}
+
+FrameGraph::Uniforms& FrameGraph::uniformsOf(GLuint program)
+{
+	map<GLuint, Uniforms>::iterator found = uniforms.find(program);
+	if(found != uniforms.end())
+		return found->second;
+
+	Uniforms u;
+	u.viewProjection = glGetUniformLocation(program, "perspectiveMatrix");
+	u.model = glGetUniformLocation(program, "modelviewMatrix");
+	u.normal = glGetUniformLocation(program, "normalMatrix");
+	u.material = glGetUniformLocation(program, "material");
+	u.worldOffset = glGetUniformLocation(program, "worldOffset");
+	u.viewProjectionLoaded = false;
+	u.modelLoaded = false;
+	u.materialLoaded = false;
+	u.worldOffsetLoaded = false;
+	return uniforms[program] = u;
+}
+
+void FrameGraph::execute(const mat4& cameraViewProjection)
+{
+	TRACE_ZONE("FrameGraph::execute");
+	for(size_t p = 0; p < passes.size(); p++)
+		sortDraws(passes[p].draws);
+
+	schedule();
+	for(size_t o = 0; o < order.size(); o++)
+	{
+		Pass& pass = passes[order[o]];
+		if(pass.draws.empty())
+			continue;
+		TRACE_ZONE(pass.name.c_str());
+
+		bindTarget(pass);
+		applyState(pass.state);
+		if(pass.clearDepth)
+		{
+			/* glClear honours the depth mask*/
+			if(!current.depthWrite)
+			{
+				PassState writable = current;
+				writable.depthWrite = true;
+				applyState(writable);
+			}
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+
+		const mat4& viewProjection = pass.ownViewProjection ? pass.viewProjection : cameraViewProjection;
+		for(size_t d = 0; d < pass.draws.size(); d++)
+		{
+			const DrawItem& draw = pass.draws[d];
+			if(glState.useProgram(draw.program))
+				totals.programSwitches++;
+			if(glState.bindVertexArray(draw.vao))
+				totals.vaoSwitches++;
+
+			/* uniforms stay with their program, so each is only loaded when it changes*/
+			Uniforms& u = uniformsOf(draw.program);
+			if(!u.viewProjectionLoaded || u.lastViewProjection != viewProjection)
+			{
+				glUniformMatrix4fv(u.viewProjection, 1, false, &viewProjection[0][0]);
+				u.lastViewProjection = viewProjection;
+				u.viewProjectionLoaded = true;
+			}
+			if(!u.modelLoaded || u.lastModel != draw.model)
+			{
+				glUniformMatrix4fv(u.model, 1, false, &draw.model[0][0]);
+				if(u.normal >= 0)
+				{
+					mat3 normal = transpose(inverse(mat3(draw.model)));
+					glUniformMatrix3fv(u.normal, 1, false, &normal[0][0]);
+				}
+				u.lastModel = draw.model;
+				u.modelLoaded = true;
+			}
+			if(u.material >= 0 && (!u.materialLoaded || u.lastMaterial != draw.material))
+			{
+				glUniform1i(u.material, draw.material);
+				u.lastMaterial = draw.material;
+				u.materialLoaded = true;
+			}
+			if(u.worldOffset >= 0 && (!u.worldOffsetLoaded || u.lastWorldOffset != draw.worldOffset))
+			{
+				glUniform3fv(u.worldOffset, 1, &draw.worldOffset[0]);
+				u.lastWorldOffset = draw.worldOffset;
+				u.worldOffsetLoaded = true;
+			}
+
+			if(draw.mode == GL_POINTS && draw.pointSize != currentPointSize)
+			{
+				glPointSize(draw.pointSize);
+				currentPointSize = draw.pointSize;
+				totals.stateChanges++;
+			}
+
+			if(draw.indexed && draw.instances > 0)
+				glDrawElementsInstanced(draw.mode, draw.count, GL_UNSIGNED_INT, (void*)0, draw.instances);
+			else if(draw.indexed)
+				glDrawElements(draw.mode, draw.count, GL_UNSIGNED_INT, (void*)0);
+			else if(draw.instances > 0)
+				glDrawArraysInstanced(draw.mode, draw.first, draw.count, draw.instances);
+			else
+				glDrawArrays(draw.mode, draw.first, draw.count);
+			totals.draws++;
+		}
+		pass.draws.clear();
+	}
+
+	/* leave the window bound with the defaults for glClear. The program and vertex array
+	 * stay bound, the next frame's first draw is likely to want them again*/
+	Pass window;
+	window.framebuffer = 0;
+	bindTarget(window);
+	applyState(PassState());
+	totals.frames++;
+}
+
+vector<string> FrameGraph::lastOrder() const
+{
+	vector<string> names;
+	for(size_t o = 0; o < order.size(); o++)
+		names.push_back(passes[order[o]].name);
+	return names;
+}
+
+void FrameGraph::printStats() const
+{
+	if(totals.frames == 0)
+		return;
+
+	float frames = totals.frames;
+	cout << "Frame graph, per frame: " << totals.draws/frames << " draws, "
+		 << totals.programSwitches/frames << " program switches, "
+		 << totals.vaoSwitches/frames << " vertex array switches, "
+		 << totals.stateChanges/frames << " state changes" << endl;
+
+	vector<string> names = lastOrder();
+	cout << "  pass order:";
+	for(size_t i = 0; i < names.size(); i++)
+		cout << " " << names[i];
+	cout << endl;
+}
@@ -0,0 +1,127 @@
+#ifndef FRAMEGRAPH_H
+#define FRAMEGRAPH_H
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdint>
+
+using namespace glm;
+
+/* Fixed function state a pass sets once for all of its draws */
+struct PassState{
+	bool depthTest, depthWrite, colourWrite;
+	GLenum depthFunc;
+
+	PassState(): depthTest(true), depthWrite(true), colourWrite(true), depthFunc(GL_LEQUAL){}
+};
+
+/* One draw call and everything it binds. Programs take the frame's view projection as
+ * perspectiveMatrix, the model matrix as modelviewMatrix, its inverse transpose as
+ * normalMatrix and an index into the Materials block as material. Programs that place
+ * their instances themselves, the carts', also take worldOffset */
+struct DrawItem{
+	GLuint program, vao;
+	GLenum mode;
+	GLint first;			//first vertex of a glDrawArrays
+	GLsizei count;
+	GLsizei instances;		//0 for a plain draw
+	bool indexed;			//glDrawElements with unsigned int indices, else glDrawArrays
+	float pointSize;
+	int material;
+	mat4 model;
+	vec3 worldOffset;		//added to the world position after the program places the model
+
+	DrawItem(GLuint _program, GLuint _vao, GLenum _mode, GLsizei _count, int _material, const mat4& _model = mat4(1.0f)):
+		program(_program), vao(_vao), mode(_mode), first(0), count(_count), instances(0), indexed(true),
+		pointSize(1.0f), material(_material), model(_model), worldOffset(0.0f){}
+
+	/* draws sharing a program and then a vertex array sort next to each other */
+	uint64_t key() const { return ((uint64_t)program << 32) | ((uint64_t)vao << 8) | (uint64_t)(mode & 0xff); }
+};
+
+/* Passes declare the resources they read and write and get draws submitted each frame.
+ * The graph runs a pass only after the passes whose output it uses, picks among passes
+ * that are free to go next the one that continues with the program already bound,
+ * sorts draws within a pass by state and skips binds and state changes that would
+ * repeat what is already set. */
+class FrameGraph{
+public:
+	struct Stats{
+		int frames, draws, programSwitches, vaoSwitches, stateChanges;
+		Stats(): frames(0), draws(0), programSwitches(0), vaoSwitches(0), stateChanges(0){}
+	};
+
+	FrameGraph(): boundFramebuffer(0), screenWidth(0), screenHeight(0),
+				currentPointSize(1.0f), stateKnown(false){}
+
+	int addPass(const std::string& name, const PassState& state);
+	void reads(int pass, const std::string& resource);
+	void writes(int pass, const std::string& resource);
+
+	/* draws the pass into framebuffer instead of the window, clearing its depth first if asked */
+	void target(int pass, GLuint framebuffer, int width, int height, bool clearDepth);
+	/* a pass with its own camera, such as the light's for a shadow map */
+	void setViewProjection(int pass, const mat4& viewProjection);
+	/* size of the window's framebuffer, restored after passes that draw elsewhere */
+	void screen(int width, int height);
+
+	void submit(int pass, const DrawItem& draw);
+	/* runs every pass with the draws submitted since the last execute, then drops them.
+	 * A pass that got no draws is skipped, leaving whatever it last drew in its target */
+	void execute(const mat4& viewProjection);
+
+	/* call when programs were deleted or rebuilt, their ids may be reused */
+	void programsChanged();
+
+	/* the order passes ran in last frame, by name */
+	std::vector<std::string> lastOrder() const;
+	const Stats& stats() const { return totals; }
+	void printStats() const;
+
+private:
+	struct Pass{
+		std::string name;
+		PassState state;
+		std::vector<std::string> reads, writes;
+		std::vector<DrawItem> draws;
+		GLuint framebuffer;		//0 for the window
+		int width, height;
+		bool clearDepth;
+		bool ownViewProjection;
+		mat4 viewProjection;
+	};
+
+	/* uniform locations looked up once per program, programs change on hot reload */
+	struct Uniforms{
+		GLint viewProjection, model, normal, material, worldOffset;
+		mat4 lastViewProjection, lastModel;
+		int lastMaterial;
+		vec3 lastWorldOffset;
+		bool viewProjectionLoaded, modelLoaded, materialLoaded, worldOffsetLoaded;
+	};
+
+	void schedule();
+	void sortDraws(std::vector<DrawItem>& draws) const;
+	bool dependsOn(int later, int earlier) const;
+	void applyState(const PassState& state);
+	void bindTarget(const Pass& pass);
+	Uniforms& uniformsOf(GLuint program);
+
+	std::vector<Pass> passes;
+	std::vector<int> order;
+	std::vector<bool> scheduled;	//kept with order between frames, so scheduling doesn't allocate
+	std::map<GLuint, Uniforms> uniforms;
+	Stats totals;
+
+	/* the framebuffer bound right now, programs and vertex arrays are left to glState */
+	GLuint boundFramebuffer;
+	int screenWidth, screenHeight;
+	PassState current;
+	float currentPointSize;
+	bool stateKnown;
+};
+
+#endif
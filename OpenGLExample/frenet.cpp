@@ -0,0 +1,101 @@
+#include "frenet.h"
+
+/*temporary tangent used to calculate the normal*/
+vec3 tangentTemp(vec3 nextPos, vec3 prevPos)
+{
+	vec3 T = nextPos - prevPos;
+	T = T / getLength(T);
+	return T;
+}
+/*Tangent of the frenet frame from, the binormal B, and normal N*/
+vec3 tangent(vec3 B, vec3 N)
+{
+	vec3 T = cross(N,B);
+	T = T / getLength(T);
+	return T;
+	
+}
+/* The normal of the frenet Frame given the centripetal acceleration direction centDirection, gravity, velocity, and curvature r (or 1/k) */
+vec3 normal(vec3 centDirection, vec3 gravity, float v, float r)
+{
+	vec3 N = (((v*v)/r) * centDirection) + gravity;
+	N = N / getLength(N);
+	return N;
+}
+/* used for figuring out the curvature of the curve in order to determine how much the cart tilts*/
+float curvature (vec3 nextPos, vec3 currPos, vec3 prevPos)
+{
+	vec3 nVec = (nextPos - (2.0f * currPos) + prevPos);
+	float x = 0.5f * getLength(nVec);
+	float c = 0.5f * getLength((nextPos - prevPos));
+
+	float k = 1.0f / ((x*x)+(c*c));
+
+
+	return k;
+}
+
+/* radius of the circle through prevPos, currPos and nextPos, from the sagitta x and half chord c.
+ * curvature() above is tuned for tilting the cart, this is the physical radius used for g-forces.
+ * Returns 0 on a straight section */
+float radiusOfCurvature(vec3 nextPos, vec3 currPos, vec3 prevPos)
+{
+	float x = 0.5f * getLength(nextPos - (2.0f * currPos) + prevPos);
+	float c = 0.5f * getLength(nextPos - prevPos);
+
+	if(x <= 1e-6f * c)
+		return 0.0f;
+
+	return ((x*x) + (c*c)) / (2.0f * x);
+}
+
+/*direction of the centripetal force*/
+vec3 centDir (vec3 nextPos, vec3 currPos, vec3 prevPos)
+{
+	vec3 nVec = (nextPos - (2.0f * currPos) + prevPos);
+	nVec = nVec / getLength(nVec);
+	return nVec;
+}
+/*gets the length of a vector*/
+float getLength(vec3 v)
+{
+	return sqrt((v.x * v.x) + (v.y * v.y) + (v.z * v.z));
+}
+
+/* Calculate the binormal of the curve*/
+vec3 binormal(vec3 normal, vec3 tangent)
+{
+	vec3 B = cross(normal, tangent);
+	B = B / getLength(B);
+	return B;
+	
+}
+
+/*
+							B.x,N.x,T.x,0.0
+							B.y,N.y,T.y,0.0
+							B.z,N.z,T.z,0.0
+							0.0,0.0,0.0,1.0);
+
+Sets up the frenet frame with the Normal N, binormal B, tangent T
+*/
+mat4 freFrame(vec3 N, vec3 B, vec3 T)
+{
+	mat4 frenetFrame;
+	
+	frenetFrame[0][0] = B.x; 
+	frenetFrame[0][1] = B.y; 
+	frenetFrame[0][2] = B.z;
+	
+	frenetFrame[1][0] = N.x; 
+	frenetFrame[1][1] = N.y; 
+	frenetFrame[1][2] = N.z;
+	
+	frenetFrame[2][0] = T.x; 
+	frenetFrame[2][1] = T.y; 
+	frenetFrame[2][2] = T.z;
+	
+	
+	
+	return frenetFrame;
+}
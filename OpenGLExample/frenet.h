@@ -0,0 +1,20 @@
+#ifndef FRENET_H
+#define FRENET_H
+
+#include "glm/glm.hpp"
+
+using namespace glm;
+
+/* Frenet frame helpers shared by the cart animation, the rail builder and the ride analytics */
+
+vec3 tangentTemp(vec3 nextPos, vec3 prevPos);
+vec3 tangent(vec3 B, vec3 N);
+vec3 normal(vec3 centDirection, vec3 gravity, float v, float r);
+float curvature(vec3 nextPos, vec3 currPos, vec3 prevPos);
+float radiusOfCurvature(vec3 nextPos, vec3 currPos, vec3 prevPos);
+vec3 centDir(vec3 nextPos, vec3 currPos, vec3 prevPos);
+float getLength(vec3 v);
+vec3 binormal(vec3 normal, vec3 tangent);
+mat4 freFrame(vec3 N, vec3 B, vec3 T);
+
+#endif
@@ -0,0 +1,389 @@
+#include "frenet_batch.h"
+#include "frenet.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FRENET_SSE_KERNELS
+#if defined(__GNUC__) && !defined(__clang__)
+#define FRENET_AVX2_KERNELS
+#endif
+#endif
+
+using namespace std;
+
+void CurveSoA::build(const vector<vec3>& points)
+{
+	count = points.size();
+	padded.resize(count + 2);
+	if(count == 0)
+		return;
+
+	padded.set(0, points[count - 1]);
+	for(size_t i = 0; i < count; i++)
+		padded.set(i + 1, points[i]);
+	padded.set(count + 1, points[0]);
+}
+
+void CurveSoA::buildSpan(const vector<vec3>& points, size_t first, size_t spanCount)
+{
+	size_t n = points.size();
+	count = spanCount;
+	padded.resize(count + 2);
+	if(n == 0)
+		return;
+
+	for(size_t i = 0; i < count + 2; i++)
+		padded.set(i, points[(first + n - 1 + i) % n]);
+}
+
+/* One entry per kernel, each returns how many elements it handled */
+struct FrenetKernels{
+	size_t (*length)(Vec3In, float*, size_t);
+	size_t (*tangentTemp)(Vec3In, Vec3In, Vec3Out, size_t);
+	size_t (*centDir)(Vec3In, Vec3In, Vec3In, Vec3Out, size_t);
+	size_t (*curvature)(Vec3In, Vec3In, Vec3In, float*, size_t);
+	size_t (*normal)(Vec3In, vec3, const float*, const float*, Vec3Out, size_t);
+	size_t (*binormal)(Vec3In, Vec3In, Vec3Out, size_t);
+	size_t (*tangent)(Vec3In, Vec3In, Vec3Out, size_t);
+};
+
+// --------------------------------------------------------------------------
+// Scalar kernels, the helpers from frenet.h in a loop. Also finish the tail of the wide kernels
+
+static inline vec3 get(Vec3In a, size_t i) { return vec3(a.x[i], a.y[i], a.z[i]); }
+static inline void put(Vec3Out a, size_t i, vec3 v) { a.x[i] = v.x; a.y[i] = v.y; a.z[i] = v.z; }
+
+static void lengthScalar(Vec3In v, float* out, size_t from, size_t n)
+{
+	for(size_t i = from; i < n; i++)
+		out[i] = getLength(get(v, i));
+}
+
+static void tangentTempScalar(Vec3In nextPos, Vec3In prevPos, Vec3Out out, size_t from, size_t n)
+{
+	for(size_t i = from; i < n; i++)
+		put(out, i, tangentTemp(get(nextPos, i), get(prevPos, i)));
+}
+
+static void centDirScalar(Vec3In nextPos, Vec3In currPos, Vec3In prevPos, Vec3Out out, size_t from, size_t n)
+{
+	for(size_t i = from; i < n; i++)
+		put(out, i, centDir(get(nextPos, i), get(currPos, i), get(prevPos, i)));
+}
+
+static void curvatureScalar(Vec3In nextPos, Vec3In currPos, Vec3In prevPos, float* out, size_t from, size_t n)
+{
+	for(size_t i = from; i < n; i++)
+		out[i] = curvature(get(nextPos, i), get(currPos, i), get(prevPos, i));
+}
+
+static void normalScalar(Vec3In centDirection, vec3 gravity, const float* v, const float* k, Vec3Out out, size_t from, size_t n)
+{
+	for(size_t i = from; i < n; i++)
+		put(out, i, normal(get(centDirection, i), gravity, v[i], 1.0f / k[i]));
+}
+
+static void binormalScalar(Vec3In N, Vec3In T, Vec3Out out, size_t from, size_t n)
+{
+	for(size_t i = from; i < n; i++)
+		put(out, i, binormal(get(N, i), get(T, i)));
+}
+
+static void tangentScalar(Vec3In B, Vec3In N, Vec3Out out, size_t from, size_t n)
+{
+	for(size_t i = from; i < n; i++)
+		put(out, i, tangent(get(B, i), get(N, i)));
+}
+
+/* the scalar set does no wide work and leaves everything to the tail loops*/
+static size_t noLength(Vec3In, float*, size_t) { return 0; }
+static size_t noPair(Vec3In, Vec3In, Vec3Out, size_t) { return 0; }
+static size_t noTriple(Vec3In, Vec3In, Vec3In, Vec3Out, size_t) { return 0; }
+static size_t noCurvature(Vec3In, Vec3In, Vec3In, float*, size_t) { return 0; }
+static size_t noNormal(Vec3In, vec3, const float*, const float*, Vec3Out, size_t) { return 0; }
+
+static const FrenetKernels scalarKernels = {
+	noLength, noPair, noTriple, noCurvature, noNormal, noPair, noPair
+};
+
+// --------------------------------------------------------------------------
+// SSE kernels, 4 floats wide. SSE2 is part of x86-64 so these need no target options
+
+#ifdef FRENET_SSE_KERNELS
+namespace sse
+{
+	struct Lane { __m128 v; };
+	static const size_t WIDTH = 4;
+
+	static inline Lane lane(__m128 v) { Lane l = { v }; return l; }
+	static inline Lane load(const float* p) { return lane(_mm_loadu_ps(p)); }
+	static inline void store(float* p, Lane a) { _mm_storeu_ps(p, a.v); }
+	static inline Lane splat(float f) { return lane(_mm_set1_ps(f)); }
+	static inline Lane root(Lane a) { return lane(_mm_sqrt_ps(a.v)); }
+	static inline Lane operator+(Lane a, Lane b) { return lane(_mm_add_ps(a.v, b.v)); }
+	static inline Lane operator-(Lane a, Lane b) { return lane(_mm_sub_ps(a.v, b.v)); }
+	static inline Lane operator*(Lane a, Lane b) { return lane(_mm_mul_ps(a.v, b.v)); }
+	static inline Lane operator/(Lane a, Lane b) { return lane(_mm_div_ps(a.v, b.v)); }
+
+#include "frenet_kernels.inl"
+
+	static const FrenetKernels kernels = {
+		lengthKernel, tangentTempKernel, centDirKernel, curvatureKernel,
+		normalKernel, binormalKernel, tangentKernel
+	};
+}
+#endif
+
+// --------------------------------------------------------------------------
+// AVX2 kernels, 8 floats wide, compiled for AVX2 whatever the rest of the build targets
+
+#ifdef FRENET_AVX2_KERNELS
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace avx2
+{
+	struct Lane { __m256 v; };
+	static const size_t WIDTH = 8;
+
+	static inline Lane lane(__m256 v) { Lane l = { v }; return l; }
+	static inline Lane load(const float* p) { return lane(_mm256_loadu_ps(p)); }
+	static inline void store(float* p, Lane a) { _mm256_storeu_ps(p, a.v); }
+	static inline Lane splat(float f) { return lane(_mm256_set1_ps(f)); }
+	static inline Lane root(Lane a) { return lane(_mm256_sqrt_ps(a.v)); }
+	static inline Lane operator+(Lane a, Lane b) { return lane(_mm256_add_ps(a.v, b.v)); }
+	static inline Lane operator-(Lane a, Lane b) { return lane(_mm256_sub_ps(a.v, b.v)); }
+	static inline Lane operator*(Lane a, Lane b) { return lane(_mm256_mul_ps(a.v, b.v)); }
+	static inline Lane operator/(Lane a, Lane b) { return lane(_mm256_div_ps(a.v, b.v)); }
+
+#include "frenet_kernels.inl"
+
+	static const FrenetKernels kernels = {
+		lengthKernel, tangentTempKernel, centDirKernel, curvatureKernel,
+		normalKernel, binormalKernel, tangentKernel
+	};
+}
+#pragma GCC pop_options
+#endif
+
+// --------------------------------------------------------------------------
+// Runtime selection
+
+static const FrenetKernels* kernelTable[FRENET_KERNEL_COUNT] = {
+	&scalarKernels,
+#ifdef FRENET_SSE_KERNELS
+	&sse::kernels,
+#else
+	0,
+#endif
+#ifdef FRENET_AVX2_KERNELS
+	&avx2::kernels,
+#else
+	0,
+#endif
+};
+
+static const FrenetKernels* active = 0;
+static FrenetKernelSet activeSet = FRENET_SCALAR;
+
+static bool cpuSupports(FrenetKernelSet set)
+{
+	if(!kernelTable[set])
+		return false;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	if(set == FRENET_AVX2)
+		return __builtin_cpu_supports("avx2");
+	if(set == FRENET_SSE)
+		return __builtin_cpu_supports("sse2");
+#endif
+	return set == FRENET_SCALAR;
+}
+
+FrenetKernelSet bestFrenetKernels()
+{
+	for(int set = FRENET_KERNEL_COUNT - 1; set > FRENET_SCALAR; set--)
+	{
+		if(cpuSupports(FrenetKernelSet(set)))
+			return FrenetKernelSet(set);
+	}
+	return FRENET_SCALAR;
+}
+
+bool selectFrenetKernels(FrenetKernelSet set)
+{
+	if(!cpuSupports(set))
+		return false;
+
+	active = kernelTable[set];
+	activeSet = set;
+	return true;
+}
+
+FrenetKernelSet currentFrenetKernels()
+{
+	if(!active)
+		selectFrenetKernels(bestFrenetKernels());
+	return activeSet;
+}
+
+const char* frenetKernelName(FrenetKernelSet set)
+{
+	switch(set)
+	{
+	case FRENET_SSE: return "SSE";
+	case FRENET_AVX2: return "AVX2";
+	default: return "scalar";
+	}
+}
+
+static inline const FrenetKernels& kernels()
+{
+	if(!active)
+		selectFrenetKernels(bestFrenetKernels());
+	return *active;
+}
+
+void lengthBatch(Vec3In v, float* out, size_t n)
+{
+	lengthScalar(v, out, kernels().length(v, out, n), n);
+}
+
+void tangentTempBatch(Vec3In nextPos, Vec3In prevPos, Vec3Out out, size_t n)
+{
+	tangentTempScalar(nextPos, prevPos, out, kernels().tangentTemp(nextPos, prevPos, out, n), n);
+}
+
+void centDirBatch(Vec3In nextPos, Vec3In currPos, Vec3In prevPos, Vec3Out out, size_t n)
+{
+	centDirScalar(nextPos, currPos, prevPos, out, kernels().centDir(nextPos, currPos, prevPos, out, n), n);
+}
+
+void curvatureBatch(Vec3In nextPos, Vec3In currPos, Vec3In prevPos, float* out, size_t n)
+{
+	curvatureScalar(nextPos, currPos, prevPos, out, kernels().curvature(nextPos, currPos, prevPos, out, n), n);
+}
+
+void normalBatch(Vec3In centDirection, vec3 gravity, const float* v, const float* k, Vec3Out out, size_t n)
+{
+	normalScalar(centDirection, gravity, v, k, out, kernels().normal(centDirection, gravity, v, k, out, n), n);
+}
+
+void binormalBatch(Vec3In N, Vec3In T, Vec3Out out, size_t n)
+{
+	binormalScalar(N, T, out, kernels().binormal(N, T, out, n), n);
+}
+
+void tangentBatch(Vec3In B, Vec3In N, Vec3Out out, size_t n)
+{
+	tangentScalar(B, N, out, kernels().tangent(B, N, out, n), n);
+}
+
+/* same steps as animate(): centripetal direction and curvature, the normal from those and the speed,
+ * the binormal against the temporary tangent and finally the frame's own tangent*/
+void frenetFramesBatch(const CurveSoA& curve, const float* speeds, vec3 gravity, FrameSoA* frames)
+{
+	size_t n = curve.count;
+	frames->resize(n);
+	if(n == 0)
+		return;
+
+	Vec3SoA tempT;
+	tempT.resize(n);
+
+	centDirBatch(curve.next(), curve.curr(), curve.prev(), Vec3Out(frames->centDir), n);
+	curvatureBatch(curve.next(), curve.curr(), curve.prev(), &frames->k[0], n);
+	normalBatch(Vec3In(frames->centDir), gravity, speeds, &frames->k[0], Vec3Out(frames->N), n);
+	tangentTempBatch(curve.next(), curve.prev(), Vec3Out(tempT), n);
+	binormalBatch(Vec3In(frames->N), Vec3In(tempT), Vec3Out(frames->B), n);
+	tangentBatch(Vec3In(frames->B), Vec3In(frames->N), Vec3Out(frames->T), n);
+}
+
+// --------------------------------------------------------------------------
+// Accuracy check against the scalar helpers
+
+static float relativeError(float a, float b)
+{
+	return std::abs(a - b) / std::max(1.0f, std::abs(b));
+}
+
+static float worstError(const Vec3SoA& a, const Vec3SoA& b)
+{
+	float worst = 0.0f;
+	for(size_t i = 0; i < a.size(); i++)
+	{
+		worst = std::max(worst, relativeError(a.x[i], b.x[i]));
+		worst = std::max(worst, relativeError(a.y[i], b.y[i]));
+		worst = std::max(worst, relativeError(a.z[i], b.z[i]));
+	}
+	return worst;
+}
+
+bool checkFrenetKernels(const vector<vec3>& points, const vector<float>& speeds, vec3 gravity, float tolerance)
+{
+	if(points.size() < 3 || speeds.size() != points.size())
+		return false;
+
+	CurveSoA curve;
+	curve.build(points);
+	size_t n = curve.count;
+
+	/* reference frames straight from frenet.h*/
+	FrameSoA reference;
+	reference.resize(n);
+	vector<float> lengths(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		vec3 prevPos = points[(i + n - 1) % n];
+		vec3 nextPos = points[(i + 1) % n];
+		vec3 cd = centDir(nextPos, points[i], prevPos);
+		float k = curvature(nextPos, points[i], prevPos);
+		vec3 N = normal(cd, gravity, speeds[i], 1.0f / k);
+		vec3 B = binormal(N, tangentTemp(nextPos, prevPos));
+
+		reference.centDir.set(i, cd);
+		reference.k[i] = k;
+		reference.N.set(i, N);
+		reference.B.set(i, B);
+		reference.T.set(i, tangent(B, N));
+		lengths[i] = getLength(points[i]);
+	}
+
+	FrenetKernelSet previous = currentFrenetKernels();
+	bool passed = true;
+
+	for(int set = FRENET_SCALAR; set < FRENET_KERNEL_COUNT; set++)
+	{
+		if(!selectFrenetKernels(FrenetKernelSet(set)))
+		{
+			cout << "Frenet kernels " << frenetKernelName(FrenetKernelSet(set)) << ": not supported here" << endl;
+			continue;
+		}
+
+		FrameSoA frames;
+		vector<float> batchLengths(n);
+		frenetFramesBatch(curve, &speeds[0], gravity, &frames);
+		lengthBatch(curve.curr(), &batchLengths[0], n);
+
+		float worst = 0.0f;
+		worst = std::max(worst, worstError(frames.centDir, reference.centDir));
+		worst = std::max(worst, worstError(frames.N, reference.N));
+		worst = std::max(worst, worstError(frames.B, reference.B));
+		worst = std::max(worst, worstError(frames.T, reference.T));
+		for(size_t i = 0; i < n; i++)
+		{
+			worst = std::max(worst, relativeError(frames.k[i], reference.k[i]));
+			worst = std::max(worst, relativeError(batchLengths[i], lengths[i]));
+		}
+
+		bool ok = worst <= tolerance;
+		passed = passed && ok;
+		cout << "Frenet kernels " << frenetKernelName(FrenetKernelSet(set)) << ": worst relative error "
+			 << worst << (ok ? "" : "  FAILED") << endl;
+	}
+
+	selectFrenetKernels(previous);
+	return passed;
+}
@@ -0,0 +1,86 @@
+#ifndef FRENET_BATCH_H
+#define FRENET_BATCH_H
+
+#include "glm/glm.hpp"
+#include <vector>
+#include <cstddef>
+
+using namespace glm;
+
+/* Batch versions of the helpers in frenet.h, working on one array per component (SoA).
+ * The kernels are picked at startup from AVX2, SSE or a scalar loop over frenet.h. */
+
+/* one array per component */
+struct Vec3SoA{
+	std::vector<float> x, y, z;
+
+	void resize(size_t n) { x.resize(n); y.resize(n); z.resize(n); }
+	size_t size() const { return x.size(); }
+	vec3 get(size_t i) const { return vec3(x[i], y[i], z[i]); }
+	void set(size_t i, vec3 v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+};
+
+/* read only and writable views of count elements, starting offset elements into a Vec3SoA */
+struct Vec3In{
+	const float *x, *y, *z;
+
+	Vec3In(const Vec3SoA& a, size_t offset = 0): x(&a.x[offset]), y(&a.y[offset]), z(&a.z[offset]){}
+};
+
+struct Vec3Out{
+	float *x, *y, *z;
+
+	Vec3Out(Vec3SoA& a, size_t offset = 0): x(&a.x[offset]), y(&a.y[offset]), z(&a.z[offset]){}
+};
+
+/* A closed curve with the last point copied in front and the first point copied after,
+ * so the previous, current and next points of the whole curve are plain offsets */
+struct CurveSoA{
+	Vec3SoA padded;
+	size_t count;
+
+	CurveSoA(): count(0){}
+	void build(const std::vector<vec3>& points);
+	/* just the count points from first on, which may wrap past the end of points */
+	void buildSpan(const std::vector<vec3>& points, size_t first, size_t count);
+
+	Vec3In prev() const { return Vec3In(padded, 0); }
+	Vec3In curr() const { return Vec3In(padded, 1); }
+	Vec3In next() const { return Vec3In(padded, 2); }
+};
+
+/* Frenet frame of every point of a curve, as the cart and the rails use it */
+struct FrameSoA{
+	Vec3SoA centDir, T, N, B;
+	std::vector<float> k;		//curvature() of every point
+
+	void resize(size_t n) { centDir.resize(n); T.resize(n); N.resize(n); B.resize(n); k.resize(n); }
+};
+
+enum FrenetKernelSet { FRENET_SCALAR = 0, FRENET_SSE, FRENET_AVX2, FRENET_KERNEL_COUNT };
+
+/* best set this machine runs, chosen the first time a kernel is called */
+FrenetKernelSet bestFrenetKernels();
+/* forces a kernel set, returns false if the CPU or compiler does not support it */
+bool selectFrenetKernels(FrenetKernelSet set);
+FrenetKernelSet currentFrenetKernels();
+const char* frenetKernelName(FrenetKernelSet set);
+
+void lengthBatch(Vec3In v, float* out, size_t n);
+void tangentTempBatch(Vec3In nextPos, Vec3In prevPos, Vec3Out out, size_t n);
+void centDirBatch(Vec3In nextPos, Vec3In currPos, Vec3In prevPos, Vec3Out out, size_t n);
+void curvatureBatch(Vec3In nextPos, Vec3In currPos, Vec3In prevPos, float* out, size_t n);
+/* normal() with the curvature k in place of the radius r = 1/k */
+void normalBatch(Vec3In centDirection, vec3 gravity, const float* v, const float* k, Vec3Out out, size_t n);
+void binormalBatch(Vec3In N, Vec3In T, Vec3Out out, size_t n);
+void tangentBatch(Vec3In B, Vec3In N, Vec3Out out, size_t n);
+
+/* every frame of the curve at once, speeds[i] is the cart's speed at point i */
+void frenetFramesBatch(const CurveSoA& curve, const float* speeds, vec3 gravity, FrameSoA* frames);
+
+/* runs each supported kernel set over points and compares it against the scalar helpers,
+ * printing the largest relative error. Returns false if any exceeds tolerance */
+bool checkFrenetKernels(const std::vector<vec3>& points, const std::vector<float>& speeds,
+						vec3 gravity, float tolerance);
+
+#endif
@@ -0,0 +1,127 @@
+// Kernel bodies shared by every instruction set in frenet_batch.cpp.
+// The including namespace defines Lane, WIDTH, load(), store(), splat(), root() and the
+// arithmetic operators. Each kernel handles the largest multiple of WIDTH elements and
+// returns how many it did, the caller finishes the tail with the scalar helpers.
+
+static inline void normalizeLanes(Lane& x, Lane& y, Lane& z)
+{
+	Lane inv = splat(1.0f) / root(x*x + y*y + z*z);
+	x = x*inv;
+	y = y*inv;
+	z = z*inv;
+}
+
+static size_t lengthKernel(Vec3In v, float* out, size_t n)
+{
+	size_t i = 0;
+	for(; i + WIDTH <= n; i += WIDTH)
+	{
+		Lane x = load(v.x + i), y = load(v.y + i), z = load(v.z + i);
+		store(out + i, root(x*x + y*y + z*z));
+	}
+	return i;
+}
+
+static size_t tangentTempKernel(Vec3In nextPos, Vec3In prevPos, Vec3Out out, size_t n)
+{
+	size_t i = 0;
+	for(; i + WIDTH <= n; i += WIDTH)
+	{
+		Lane x = load(nextPos.x + i) - load(prevPos.x + i);
+		Lane y = load(nextPos.y + i) - load(prevPos.y + i);
+		Lane z = load(nextPos.z + i) - load(prevPos.z + i);
+		normalizeLanes(x, y, z);
+		store(out.x + i, x);
+		store(out.y + i, y);
+		store(out.z + i, z);
+	}
+	return i;
+}
+
+static size_t centDirKernel(Vec3In nextPos, Vec3In currPos, Vec3In prevPos, Vec3Out out, size_t n)
+{
+	size_t i = 0;
+	Lane two = splat(2.0f);
+	for(; i + WIDTH <= n; i += WIDTH)
+	{
+		Lane x = load(nextPos.x + i) - two*load(currPos.x + i) + load(prevPos.x + i);
+		Lane y = load(nextPos.y + i) - two*load(currPos.y + i) + load(prevPos.y + i);
+		Lane z = load(nextPos.z + i) - two*load(currPos.z + i) + load(prevPos.z + i);
+		normalizeLanes(x, y, z);
+		store(out.x + i, x);
+		store(out.y + i, y);
+		store(out.z + i, z);
+	}
+	return i;
+}
+
+static size_t curvatureKernel(Vec3In nextPos, Vec3In currPos, Vec3In prevPos, float* out, size_t n)
+{
+	size_t i = 0;
+	Lane two = splat(2.0f), quarter = splat(0.25f), one = splat(1.0f);
+	for(; i + WIDTH <= n; i += WIDTH)
+	{
+		Lane nx = load(nextPos.x + i), ny = load(nextPos.y + i), nz = load(nextPos.z + i);
+		Lane px = load(prevPos.x + i), py = load(prevPos.y + i), pz = load(prevPos.z + i);
+
+		Lane sx = nx - two*load(currPos.x + i) + px;
+		Lane sy = ny - two*load(currPos.y + i) + py;
+		Lane sz = nz - two*load(currPos.z + i) + pz;
+		Lane cx = nx - px, cy = ny - py, cz = nz - pz;
+
+		/* x = |s|/2 and c = |chord|/2, so x*x + c*c needs no square roots*/
+		Lane xx = quarter*(sx*sx + sy*sy + sz*sz);
+		Lane cc = quarter*(cx*cx + cy*cy + cz*cz);
+		store(out + i, one / (xx + cc));
+	}
+	return i;
+}
+
+static size_t normalKernel(Vec3In centDirection, vec3 gravity, const float* v, const float* k, Vec3Out out, size_t n)
+{
+	size_t i = 0;
+	Lane gx = splat(gravity.x), gy = splat(gravity.y), gz = splat(gravity.z);
+	for(; i + WIDTH <= n; i += WIDTH)
+	{
+		Lane speed = load(v + i);
+		Lane a = speed*speed*load(k + i);
+		Lane x = a*load(centDirection.x + i) + gx;
+		Lane y = a*load(centDirection.y + i) + gy;
+		Lane z = a*load(centDirection.z + i) + gz;
+		normalizeLanes(x, y, z);
+		store(out.x + i, x);
+		store(out.y + i, y);
+		store(out.z + i, z);
+	}
+	return i;
+}
+
+/* normalized a x b*/
+static inline void crossLanes(Vec3In a, Vec3In b, Vec3Out out, size_t i)
+{
+	Lane ax = load(a.x + i), ay = load(a.y + i), az = load(a.z + i);
+	Lane bx = load(b.x + i), by = load(b.y + i), bz = load(b.z + i);
+	Lane x = ay*bz - az*by;
+	Lane y = az*bx - ax*bz;
+	Lane z = ax*by - ay*bx;
+	normalizeLanes(x, y, z);
+	store(out.x + i, x);
+	store(out.y + i, y);
+	store(out.z + i, z);
+}
+
+static size_t binormalKernel(Vec3In N, Vec3In T, Vec3Out out, size_t n)
+{
+	size_t i = 0;
+	for(; i + WIDTH <= n; i += WIDTH)
+		crossLanes(N, T, out, i);
+	return i;
+}
+
+static size_t tangentKernel(Vec3In B, Vec3In N, Vec3Out out, size_t n)
+{
+	size_t i = 0;
+	for(; i + WIDTH <= n; i += WIDTH)
+		crossLanes(N, B, out, i);
+	return i;
+}
@@ -0,0 +1,179 @@
+#include "glstate.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+GLState glState;
+
+/* never a real name, so the first call of each kind always goes through*/
+static const GLuint unknown = ~0u;
+
+/* glBindBufferBase and Range also move the uniform and feedback targets, so those aren't tracked*/
+static const GLenum trackedBuffers[] = {GL_ARRAY_BUFFER, GL_TEXTURE_BUFFER};
+
+GLState::GLState(): frames(0)
+{
+	for(int k = 0; k < CALL_KINDS; k++)
+		issued[k] = filtered[k] = 0;
+	invalidate();
+}
+
+void GLState::invalidate()
+{
+	currentProgram = currentVertexArray = unknown;
+	for(int b = 0; b < bufferTargets; b++)
+		buffers[b] = unknown;
+	for(int u = 0; u < units; u++)
+	{
+		textures[u] = unknown;
+		textureTargets[u] = 0;
+	}
+	activeUnit = -1;
+	viewportKnown = false;
+}
+
+void GLState::forgetPrograms()
+{
+	currentProgram = unknown;
+	locations.clear();
+}
+
+bool GLState::useProgram(GLuint program)
+{
+	if(program == currentProgram)
+	{
+		filtered[CALL_PROGRAM]++;
+		return false;
+	}
+	glUseProgram(program);
+	currentProgram = program;
+	issued[CALL_PROGRAM]++;
+	return true;
+}
+
+bool GLState::bindVertexArray(GLuint vao)
+{
+	if(vao == currentVertexArray)
+	{
+		filtered[CALL_VERTEX_ARRAY]++;
+		return false;
+	}
+	glBindVertexArray(vao);
+	currentVertexArray = vao;
+	issued[CALL_VERTEX_ARRAY]++;
+	return true;
+}
+
+int GLState::bufferSlot(GLenum target) const
+{
+	for(int b = 0; b < bufferTargets; b++)
+		if(trackedBuffers[b] == target)
+			return b;
+	return -1;
+}
+
+bool GLState::bindBuffer(GLenum target, GLuint buffer)
+{
+	int slot = bufferSlot(target);
+	if(slot >= 0 && buffers[slot] == buffer)
+	{
+		filtered[CALL_BUFFER]++;
+		return false;
+	}
+	glBindBuffer(target, buffer);
+	if(slot >= 0)
+		buffers[slot] = buffer;
+	issued[CALL_BUFFER]++;
+	return true;
+}
+
+bool GLState::bindTexture(GLint unit, GLenum target, GLuint texture)
+{
+	bool tracked = unit >= 0 && unit < units;
+	if(tracked && textures[unit] == texture && textureTargets[unit] == target)
+	{
+		filtered[CALL_TEXTURE]++;
+		return false;
+	}
+	if(unit != activeUnit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit = unit;
+		issued[CALL_TEXTURE]++;
+	}
+	glBindTexture(target, texture);
+	if(tracked)
+	{
+		textures[unit] = texture;
+		textureTargets[unit] = target;
+	}
+	issued[CALL_TEXTURE]++;
+	return true;
+}
+
+bool GLState::viewport(int x, int y, int width, int height)
+{
+	if(viewportKnown && currentViewport[0] == x && currentViewport[1] == y
+		&& currentViewport[2] == width && currentViewport[3] == height)
+	{
+		filtered[CALL_VIEWPORT]++;
+		return false;
+	}
+	glViewport(x, y, width, height);
+	currentViewport[0] = x;
+	currentViewport[1] = y;
+	currentViewport[2] = width;
+	currentViewport[3] = height;
+	viewportKnown = true;
+	issued[CALL_VIEWPORT]++;
+	return true;
+}
+
+const int* GLState::getViewport()
+{
+	if(!viewportKnown)
+	{
+		glGetIntegerv(GL_VIEWPORT, currentViewport);
+		viewportKnown = true;
+		issued[CALL_VIEWPORT]++;
+	}
+	else
+		filtered[CALL_VIEWPORT]++;
+	return currentViewport;
+}
+
+GLint GLState::uniformLocation(GLuint program, const char* name)
+{
+	pair<GLuint, const char*> key(program, name);
+	map<pair<GLuint, const char*>, GLint>::iterator found = locations.find(key);
+	if(found != locations.end())
+	{
+		filtered[CALL_UNIFORM_LOOKUP]++;
+		return found->second;
+	}
+	issued[CALL_UNIFORM_LOOKUP]++;
+	return locations[key] = glGetUniformLocation(program, name);
+}
+
+void GLState::printStats() const
+{
+	if(frames == 0)
+		return;
+
+	static const char* names[CALL_KINDS] = {"program", "vertex array", "buffer", "texture", "viewport", "uniform lookup"};
+	long totalIssued = 0, totalAsked = 0;
+	streamsize precision = cout.precision();
+	cout << fixed << setprecision(1);
+	cout << "GL state calls per frame, sent to the driver out of asked for:";
+	for(int k = 0; k < CALL_KINDS; k++)
+	{
+		totalIssued += issued[k];
+		totalAsked += issued[k] + filtered[k];
+		cout << " " << names[k] << " " << float(issued[k])/frames << "/" << float(issued[k] + filtered[k])/frames << ",";
+	}
+	cout << " all " << float(totalIssued)/frames << "/" << float(totalAsked)/frames << endl;
+	cout.unsetf(ios::floatfield);
+	cout.precision(precision);
+}
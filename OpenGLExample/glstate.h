@@ -0,0 +1,62 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include "glad/glad.h"
+#include <map>
+
+/* Shadows the context's bindings so a call that would set what is already set never
+ * reaches the driver, and answers the viewport and uniform locations without asking it.
+ * Only holds while every bind of what it tracks goes through it. Buffers other than the
+ * array and texture buffers always go through, element arrays belong to the vertex array. */
+class GLState{
+public:
+	/* what the driver was asked to do and what was filtered out, per kind of call */
+	enum CallKind{ CALL_PROGRAM = 0, CALL_VERTEX_ARRAY, CALL_BUFFER, CALL_TEXTURE, CALL_VIEWPORT, CALL_UNIFORM_LOOKUP, CALL_KINDS };
+
+	GLState();
+
+	/* each returns true if the call reached the driver */
+	bool useProgram(GLuint program);
+	bool bindVertexArray(GLuint vao);
+	bool bindBuffer(GLenum target, GLuint buffer);
+	bool bindTexture(GLint unit, GLenum target, GLuint texture);
+	bool viewport(int x, int y, int width, int height);
+
+	GLuint program() const { return currentProgram; }
+	/* x, y, width, height, asked of the driver only before anything has set it */
+	const int* getViewport();
+	/* looked up once per program and name. name is cached by address, so it should be a
+	 * literal, and a lookup costs no copy of it */
+	GLint uniformLocation(GLuint program, const char* name);
+
+	/* programs were rebuilt, their ids and locations may be reused */
+	void forgetPrograms();
+	/* something bound behind the cache's back, the next call of every kind goes through */
+	void invalidate();
+
+	void endFrame() { frames++; }
+	void printStats() const;
+
+private:
+	int bufferSlot(GLenum target) const;
+
+	static const int units = 8;
+	static const int bufferTargets = 2;
+
+	GLuint currentProgram, currentVertexArray;
+	GLuint buffers[bufferTargets];
+	GLuint textures[units];
+	GLenum textureTargets[units];
+	GLint activeUnit;
+	int currentViewport[4];
+	bool viewportKnown;
+	std::map<std::pair<GLuint, const char*>, GLint> locations;
+
+	long issued[CALL_KINDS], filtered[CALL_KINDS];
+	int frames;
+};
+
+/* the one context's state */
+extern GLState glState;
+
+#endif
@@ -0,0 +1,35 @@
+// ==========================================================================
+// Vertex program for instanced geometry (track supports)
+//
+// Same as vertex.glsl, but each instance carries its own model matrix
+// ==========================================================================
+#version 410
+
+// locations 0 and 1 match vertex.glsl, the per-instance matrix takes 2 to 5
+layout(location = 0) in vec3 VertexPosition;
+layout(location = 1) in vec3 VertexNormal;
+layout(location = 2) in mat4 InstanceMatrix;
+
+uniform mat4 perspectiveMatrix;
+uniform mat4 modelviewMatrix;
+uniform mat3 normalMatrix;
+// output to be interpolated between vertices and passed to the fragment stage
+
+out vec3 FragNormal;
+out vec3 WorldPosition;
+
+// the depth prepass and the shading pass use different programs on this shader,
+// their depths must come out the same
+invariant gl_Position;
+
+void main()
+{
+	// instances are rotated and scaled, never sheared, so dividing by the squared
+	// scale of each axis gives the inverse transpose without inverting anything
+	mat3 instance = mat3(InstanceMatrix);
+	vec3 scaleSquared = vec3(dot(instance[0], instance[0]), dot(instance[1], instance[1]), dot(instance[2], instance[2]));
+	FragNormal = normalMatrix*(instance*(VertexNormal/scaleSquared));
+	vec4 world = modelviewMatrix*InstanceMatrix*vec4(VertexPosition, 1.0);
+	WorldPosition = world.xyz;
+	gl_Position = perspectiveMatrix*world;
+}
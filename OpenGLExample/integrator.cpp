@@ -0,0 +1,131 @@
+#include "integrator.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/* rolling friction against the normal load (gravity across the slope plus the centripetal load)
+ * and quadratic drag, both opposing the motion*/
+static float resistance(const ArcLengthTable& table, const IntegratorSettings& settings, float s, float v)
+{
+	float a = 0.0f;
+
+	if(settings.friction > 0.0f)
+	{
+		float slope = std::max(-1.0f, std::min(1.0f, table.slopeAt(s)));
+		float load = settings.gravity*std::sqrt(1.0f - slope*slope) + v*v*table.curvatureAt(s);
+		float sign = (v > 0.0f) ? 1.0f : ((v < 0.0f) ? -1.0f : 0.0f);
+		a -= sign*settings.friction*load;
+	}
+	a -= settings.drag*v*std::abs(v);
+
+	return a;
+}
+
+/* acceleration along the track, gravity along the slope plus the resistance*/
+static float acceleration(const ArcLengthTable& table, const IntegratorSettings& settings, float s, float v)
+{
+	return -settings.gravity*table.slopeAt(s) + resistance(table, settings, s, v);
+}
+
+/* one substep, returns the energy dissipated during it*/
+static float step(const ArcLengthTable& table, const IntegratorSettings& settings, CartState* state, float h)
+{
+	float s = state->s;
+	float v = state->v;
+	float a;
+
+	if(settings.type == SEMI_IMPLICIT_EULER)
+	{
+		a = acceleration(table, settings, s, v);
+		state->v = v + a*h;
+		state->s = s + state->v*h;
+	}
+	else
+	{
+		float k1v = acceleration(table, settings, s, v);
+		float k1s = v;
+		float k2v = acceleration(table, settings, s + 0.5f*h*k1s, v + 0.5f*h*k1v);
+		float k2s = v + 0.5f*h*k1v;
+		float k3v = acceleration(table, settings, s + 0.5f*h*k2s, v + 0.5f*h*k2v);
+		float k3s = v + 0.5f*h*k2v;
+		float k4v = acceleration(table, settings, s + h*k3s, v + h*k3v);
+		float k4s = v + h*k3v;
+
+		state->v = v + (h/6.0f)*(k1v + 2.0f*k2v + 2.0f*k3v + k4v);
+		state->s = s + (h/6.0f)*(k1s + 2.0f*k2s + 2.0f*k3s + k4s);
+	}
+
+	/* work done by the resistance over the substep, taken at its midpoint*/
+	float travelled = state->s - s;
+	float lost = -resistance(table, settings, s + 0.5f*travelled, 0.5f*(v + state->v))*travelled;
+
+	state->s = table.wrapDistance(state->s);
+	return lost;
+}
+
+int integrate(const ArcLengthTable& table, const IntegratorSettings& settings, CartState* state, float dt)
+{
+	if(dt <= 0.0f || table.total <= 0.0f)
+		return 0;
+
+	/* enough substeps that neither the step length nor the turn of the tangent over it gets too big*/
+	float travel = std::abs(state->v)*dt;
+	float bend = travel*table.curvatureAt(state->s);
+	int substeps = (int)std::ceil(std::max(dt/settings.maxStep, bend/settings.maxBend));
+	substeps = std::max(1, std::min(substeps, settings.maxSubsteps));
+
+	float h = dt/substeps;
+	for(int n = 0; n < substeps; n++)
+		state->dissipated += step(table, settings, state, h);
+
+	return substeps;
+}
+
+void keepMoving(CartState* state, float minSpeed)
+{
+	if(state->v >= minSpeed)
+		return;
+	state->injected += 0.5f*(minSpeed*minSpeed - state->v*state->v);
+	state->v = minSpeed;
+}
+
+float cartEnergy(const ArcLengthTable& table, const IntegratorSettings& settings, const CartState& state)
+{
+	return 0.5f*state.v*state.v + settings.gravity*table.heightAt(state.s);
+}
+
+void EnergyReport::begin(const ArcLengthTable& table, const IntegratorSettings& settings, CartState* state)
+{
+	state->dissipated = 0.0f;
+	state->injected = 0.0f;
+	startEnergy = cartEnergy(table, settings, *state);
+	worstDrift = 0.0f;
+	substeps = 0;
+	frames = 0;
+}
+
+float EnergyReport::drift(const ArcLengthTable& table, const IntegratorSettings& settings, const CartState& state) const
+{
+	float scale = std::max(std::abs(startEnergy), 1e-6f);
+	return (cartEnergy(table, settings, state) + state.dissipated - state.injected - startEnergy) / scale;
+}
+
+void EnergyReport::update(const ArcLengthTable& table, const IntegratorSettings& settings, const CartState& state, int steps)
+{
+	float d = drift(table, settings, state);
+	if(std::abs(d) > std::abs(worstDrift))
+		worstDrift = d;
+	substeps += steps;
+	frames++;
+}
+
+void EnergyReport::print(const ArcLengthTable& table, const IntegratorSettings& settings, const CartState& state) const
+{
+	cout << "Energy drift over the free section: " << drift(table, settings, state)*100.0f << "% (worst "
+		 << worstDrift*100.0f << "%), lost to friction and drag " << state.dissipated << " J/kg, "
+		 << "put in to keep it moving " << state.injected << " J/kg, "
+		 << substeps << " substeps over " << frames << " frames" << endl;
+}
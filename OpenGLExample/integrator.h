@@ -0,0 +1,57 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include "arclength.h"
+
+enum IntegratorType { SEMI_IMPLICIT_EULER, RK4 };
+
+struct IntegratorSettings{
+	IntegratorType type;
+	float gravity;			//magnitude, m/s^2
+	float friction;			//rolling friction coefficient
+	float drag;				//air drag per unit mass, a = -drag*v*|v|
+	float maxStep;			//longest substep in seconds
+	float maxBend;			//most the tangent may turn in one substep (radians), caps substeps by curvature
+	int maxSubsteps;
+
+	IntegratorSettings(): type(RK4), gravity(9.81f), friction(0.0f), drag(0.0f),
+						maxStep(1.0f/240.0f), maxBend(0.05f), maxSubsteps(64){}
+};
+
+/* Cart state along the track, per unit mass */
+struct CartState{
+	float s;				//arc length along the track
+	float v;				//speed along the tangent
+	float dissipated;		//energy lost to friction and drag since the lap started
+	float injected;			//energy put in by keeping the cart above a minimum speed
+
+	CartState(): s(0.0f), v(0.0f), dissipated(0.0f), injected(0.0f){}
+};
+
+/* advances state by dt seconds, splitting it into substeps bounded by maxStep and the track curvature.
+ * Returns the number of substeps taken */
+int integrate(const ArcLengthTable& table, const IntegratorSettings& settings, CartState* state, float dt);
+
+/* raises the speed to at least minSpeed, counting the kinetic energy that adds as injected */
+void keepMoving(CartState* state, float minSpeed);
+
+/* mechanical energy per unit mass, kinetic plus potential */
+float cartEnergy(const ArcLengthTable& table, const IntegratorSettings& settings, const CartState& state);
+
+/* Tracks how far the integrated energy strays from the energy put in at the start of a lap */
+struct EnergyReport{
+	float startEnergy;
+	float worstDrift;
+	int substeps;
+	int frames;
+
+	EnergyReport(): startEnergy(0.0f), worstDrift(0.0f), substeps(0), frames(0){}
+
+	void begin(const ArcLengthTable& table, const IntegratorSettings& settings, CartState* state);
+	void update(const ArcLengthTable& table, const IntegratorSettings& settings, const CartState& state, int steps);
+	/* relative drift of energy plus losses, less what was injected, against the starting energy */
+	float drift(const ArcLengthTable& table, const IntegratorSettings& settings, const CartState& state) const;
+	void print(const ArcLengthTable& table, const IntegratorSettings& settings, const CartState& state) const;
+};
+
+#endif
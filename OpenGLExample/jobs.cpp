@@ -0,0 +1,88 @@
+#include "jobs.h"
+#include "trace.h"
+
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+JobSystem::~JobSystem()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		quit = true;
+		jobs.clear();
+	}
+	wake.notify_all();
+	for(size_t w = 0; w < workers.size(); w++)
+		workers[w].join();
+}
+
+void JobSystem::submit(const function<void()>& job, int threads)
+{
+	{
+		lock_guard<mutex> guard(lock);
+		jobs.push_back(job);
+	}
+
+	if(workers.empty())
+	{
+		if(threads <= 0)
+			threads = std::max(1, (int)thread::hardware_concurrency() - 1);
+		for(int w = 0; w < threads; w++)
+			workers.push_back(thread(&JobSystem::run, this));
+	}
+	wake.notify_one();
+}
+
+void JobSystem::run()
+{
+	TRACE_THREAD("job worker");
+	while(true)
+	{
+		function<void()> job;
+		{
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [this]{ return quit || !jobs.empty(); });
+			if(quit)
+				return;
+
+			job.swap(jobs.front());
+			jobs.pop_front();
+		}
+		TRACE_ZONE("job");
+		job();
+	}
+}
+
+void MainThreadQueue::post(const function<void()>& work)
+{
+	lock_guard<mutex> guard(lock);
+	queue.push_back(work);
+}
+
+int MainThreadQueue::run(double budget)
+{
+	TRACE_ZONE("main thread queue");
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int ran = 0;
+	while(true)
+	{
+		function<void()> work;
+		{
+			lock_guard<mutex> guard(lock);
+			if(queue.empty())
+				break;
+			work.swap(queue.front());
+			queue.pop_front();
+		}
+
+		/* unlocked, so the work can post more*/
+		work();
+		ran++;
+
+		if(chrono::duration<double>(chrono::steady_clock::now() - start).count() >= budget)
+			break;
+	}
+	return ran;
+}
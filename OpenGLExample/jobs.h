@@ -0,0 +1,46 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/* Worker threads taking jobs in the order they were submitted. Jobs run concurrently and can
+ * finish in any order, so callers must not depend on it; bakes tag their uploads with a
+ * generation and drop stale ones. Jobs must not touch GL, anything they need done with the
+ * context goes through a MainThreadQueue. */
+class JobSystem{
+public:
+	JobSystem(): quit(false){}
+	~JobSystem();
+
+	/* threads are started on the first submit, 0 picks one less than the core count */
+	void submit(const std::function<void()>& job, int threads = 0);
+
+private:
+	void run();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()> > jobs;
+	std::mutex lock;
+	std::condition_variable wake;
+	bool quit;
+};
+
+/* Work posted from any thread and run by the thread that owns the GL context, between frames */
+class MainThreadQueue{
+public:
+	void post(const std::function<void()>& work);
+	/* runs posted work until the queue is empty or budget seconds have passed, always running at
+	 * least one item so a slow upload can't stall the queue. Returns how many items ran */
+	int run(double budget);
+
+private:
+	std::deque<std::function<void()> > queue;
+	std::mutex lock;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "lapbuffer.h"
+#include "glstate.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+void LapBuffer::init()
+{
+	glGenBuffers(1, &buffer);
+	glGenTextures(1, &texture);
+	glState.bindTexture(unit, GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+
+	GLint maxTexels;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	limit = maxTexels/2;
+}
+
+void LapBuffer::release()
+{
+	glDeleteTextures(1, &texture);
+	glDeleteBuffers(1, &buffer);
+	texture = buffer = 0;
+}
+
+bool LapBuffer::upload(const LapTable& lap)
+{
+	int count = lap.position.size();
+	if(count > limit)
+	{
+		cout << "ERROR: the lap has " << count << " samples, a texture buffer holds " << limit << endl;
+		return false;
+	}
+
+	vector<vec4> texels(2*count);
+	for(int k = 0; k < count; k++)
+	{
+		const quat& q = lap.orientation[k];
+		texels[2*k] = vec4(lap.position[k], 0.0f);
+		texels[2*k + 1] = vec4(q.x, q.y, q.z, q.w);
+	}
+
+	glState.bindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(vec4)*texels.size(), texels.empty() ? 0 : &texels[0], GL_STATIC_DRAW);
+	glState.bindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	samples = count;
+	spacing = lap.spacing;
+	return true;
+}
+
+void LapBuffer::bindTexture() const
+{
+	glState.bindTexture(unit, GL_TEXTURE_BUFFER, texture);
+}
+
+void LapBuffer::loadUniforms(GLuint program) const
+{
+	glUniform1i(glState.uniformLocation(program, "lapPoses"), unit);
+	glUniform1i(glState.uniformLocation(program, "lapSamples"), samples);
+	glUniform1f(glState.uniformLocation(program, "lapSpacing"), spacing);
+}
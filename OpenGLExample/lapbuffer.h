@@ -0,0 +1,36 @@
+#ifndef LAPBUFFER_H
+#define LAPBUFFER_H
+
+#include "glad/glad.h"
+#include "laptable.h"
+
+/* The lap table in a texture buffer, two RGBA32F texels a sample: the position, then the
+ * orientation quaternion as x, y, z, w. cart_vertex.glsl reads the two samples either side
+ * of each instance's distance and places the cart itself, so moving a car costs the CPU
+ * one float a frame */
+class LapBuffer{
+public:
+	static const GLint unit = 3;	//after the shadow maps
+
+	LapBuffer(): buffer(0), texture(0), samples(0), spacing(0.0f), limit(0){}
+
+	void init();
+	void release();
+
+	/* loads a new table, returns false if it has more samples than a texture buffer holds */
+	bool upload(const LapTable& lap);
+	/* the most samples a table can have, read from the driver once in init */
+	int maxSamples() const { return limit; }
+
+	void bindTexture() const;
+	/* loads the table's sampling into a program that reads it, the program must be in use */
+	void loadUniforms(GLuint program) const;
+
+private:
+	GLuint buffer, texture;
+	int samples;
+	float spacing;
+	int limit;
+};
+
+#endif
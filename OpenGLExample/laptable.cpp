@@ -0,0 +1,70 @@
+#include "laptable.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/* the rotation to the right handed frame B, N, -T*/
+static quat frameRotation(const mat3& frame)
+{
+	return normalize(quat_cast(mat3(frame[0], frame[1], -frame[2])));
+}
+
+void LapTable::build(const vector<vec3>& curve, const vector<mat3>& frames, const vector<float>& speeds,
+					const ArcLengthTable& arc, float targetSpacing)
+{
+	TRACE_ZONE("LapTable::build");
+	int n = curve.size();
+	position.clear();
+	orientation.clear();
+	speed.clear();
+	index.clear();
+	total = arc.total;
+	if(n < 2 || (int)frames.size() != n || (int)speeds.size() != n || total <= 0.0f || targetSpacing <= 0.0f)
+		return;
+
+	/* a whole number of samples round the lap, so the last one runs on into the first*/
+	int count = std::max((int)ceil(total/targetSpacing), 2);
+	spacing = total/count;
+	position.resize(count);
+	orientation.resize(count);
+	speed.resize(count);
+	index.resize(count);
+
+	for(int k = 0; k < count; k++)
+	{
+		float d = k*spacing;
+		int i = arc.indexAt(d);
+		int j = (i + 1) % n;
+		float length = arc.s[i + 1] - arc.s[i];
+		float t = (length > 0.0f) ? clamp((d - arc.s[i])/length, 0.0f, 1.0f) : 0.0f;
+
+		position[k] = mix(curve[i], curve[j], t);
+		orientation[k] = slerp(frameRotation(frames[i]), frameRotation(frames[j]), t);
+		speed[k] = mix(speeds[i], speeds[j], t);
+		index[k] = i;
+	}
+}
+
+LapPose LapTable::sample(float d) const
+{
+	LapPose pose;
+	int count = position.size();
+	if(count == 0)
+		return pose;
+
+	float u = d/spacing;
+	u -= floor(u/count)*count;
+	int k = std::min((int)u, count - 1);
+	int next = (k + 1 == count) ? 0 : k + 1;
+	float t = u - k;
+
+	pose.position = mix(position[k], position[next], t);
+	pose.frame = mat3_cast(slerp(orientation[k], orientation[next], t));
+	pose.frame[2] = -pose.frame[2];
+	pose.speed = mix(speed[k], speed[next], t);
+	pose.index = index[k];
+	return pose;
+}
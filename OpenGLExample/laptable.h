@@ -0,0 +1,44 @@
+#ifndef LAPTABLE_H
+#define LAPTABLE_H
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "arclength.h"
+#include <vector>
+
+using namespace glm;
+
+/* The cart's pose at one distance round the lap */
+struct LapPose{
+	vec3 position;
+	mat3 frame;		//columns B, N, T as baked
+	float speed;	//design speed
+	int index;		//curve point at or before position
+
+	LapPose(): position(0.0f), frame(1.0f), speed(0.0f), index(0){}
+};
+
+/* The cart's pose sampled round the lap at a fixed arc length spacing, baked once per track
+ * so moving the cart is two table reads and a lerp/slerp between them whatever the density
+ * of the curve. The baked frames are left handed (T runs against the direction of travel),
+ * so the orientations hold the rotation to B, N, -T and T is flipped back when sampling. */
+struct LapTable{
+	std::vector<vec3> position;
+	std::vector<quat> orientation;
+	std::vector<float> speed;
+	std::vector<int> index;
+	float spacing;		//arc length between samples
+	float total;		//length of the lap
+
+	LapTable(): spacing(0.0f), total(0.0f){}
+
+	/* samples the curve, its frames and design speeds about every targetSpacing along arc */
+	void build(const std::vector<vec3>& curve, const std::vector<mat3>& frames, const std::vector<float>& speeds,
+				const ArcLengthTable& arc, float targetSpacing);
+
+	bool empty() const { return position.empty(); }
+	/* the pose at distance d from the first curve point, any d wraps round the lap */
+	LapPose sample(float d) const;
+};
+
+#endif
@@ -17,6 +17,9 @@
 #include <algorithm>
 #include <vector>
 #include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <memory>
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -26,6 +29,28 @@
 #include <GLFW/glfw3.h>
 
 #include "camera.h"
+#include "supports.h"
+#include "frenet.h"
+#include "frenet_batch.h"
+#include "analytics.h"
+#include "integrator.h"
+#include "trackedit.h"
+#include "bake.h"
+#include "lapbuffer.h"
+#include "railgen.h"
+#include "streambuffer.h"
+#include "glstate.h"
+#include "trace.h"
+#include "perfcounters.h"
+#include "alloctrack.h"
+#include "watcher.h"
+#include "jobs.h"
+#include "shaders.h"
+#include "framegraph.h"
+#include "shadow.h"
+#include "materials.h"
+#include "replay.h"
+#include "followcamera.h"
 
 #define PI 3.14159265359
 
@@ -34,64 +59,56 @@ using namespace glm;
 
 
 //Forward definitions
-bool CheckGLErrors(string location);
+bool CheckGLErrors(const char* location);
 void QueryGLVersion();
-string LoadSource(const string &filename);
-GLuint CompileShader(GLenum shaderType, const string &source);
-GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader);
-void animate(vec3 cartLoc, int &i, vector<vec3> points, float ds, float v);
+void placeCart(const LapPose& pose);
 vector<vec3> subdivision(vector<vec3> points, vector<unsigned int>* indices, vector<vec3>* normals);
 
 void generateSquareXYZCoords(vector<vec3>* vertices, vector<vec3>* normals, 
 					vector<unsigned int>* indices);
 
-void generateWheel(vector<vec3>* vertices, vector<vec3>* normals, 
-					vector<unsigned int>* indices, float width);
+void generateWheel(vector<vec3>* vertices, vector<unsigned int>* indices);
 					
 
 
-vec3 archLength(vec3 Bt, int& i, vector<vec3> points, float Ds);
-vec3 posOnCurve(vec3 Bt, int &i, vector<vec3> points, float ds);
-vec3 tangentTemp(vec3 nextPos, vec3 currPos);
-vec3 normal(vec3 centDirection, vec3 gravity, float v, float r);
-vec3 binormal(vec3 normal, vec3 tangent);
-mat4 freFrame(vec3 N, vec3 B, vec3 T);
 vec3 binormalAtCurrPoint(vec3 nextPos, vec3 currPos, vec3 prevPos, float v);
-void createTrack (vector<vec3> points);
+void createTrack(int n);
 void createWheel(vector<vec3> points);
-float getLength(vec3 v);
 int wrap(int i);
-
-int highestPointIndex, lowestPointIndex, decIndex;
+void moveControlPoint(int index, vec3 offset);
+void rebuildTrack();
+void applyBake(TrackBake* bake);
+std::shared_ptr<TrackBake> takeSpareBake();
+void checkForChanges();
+bool frameOwed(double now);
+bool benchBake(int runs);
+bool analyzeTrack();
+void analyzeCurrentTrack();
+void startBake(const string& filename);
+void startWheelBake();
+void uploadPreview(const vector<vec3>& curve);
+void closedLoopIndices(int n, vector<unsigned int>* loop);
+void uploadControlPolygon();
+void saveTrack();
+void fitStaticShadow();
 
 vec2 mousePos;
 bool leftmousePressed = false;
 bool rightmousePressed = false;
 bool play = false;
 
-float H;
 float dt = 0.04;
-float h;
 float v;
-float ds = 0.001;
-float prevT = glfwGetTime();
-float distLow;
-float low;
-
-bool lifting = true;
-bool gravityFree = false;
-bool decel = false;
+float prevT = 0;
+float simSpeed = dt*60.0f; //seconds of simulation per second of wall clock, dt used to be one 60Hz frame
+float minCrawlSpeed = 0.5f; //a cart that stalls under friction is nudged on instead of rolling back
 
+int startPoint; //bottom of the lift hill, where the lap starts
+bool cartFree = false; //the cart is in a free section, integrated rather than read off trackSpeeds
+float brakeExcess = 0; //integrated speed over the design speed at the brakes, taken off as they slow the cart
+float brakeEntry = 0; //design speed where the brakes started
+float lapDistance = 0; //the cart's arc length from the first point of linePoints
 
-int startPoint;
-int startDec ;
-float decDist;
-float vdec;
-float currDist = 0;
-
-mat4 freeFrame = mat4(1.0f);
-mat4 mWheelR = scale(mat4(1.0f), vec3(0.5f, 0.5f, 0.5f));
-mat4 mWheelL = scale(mat4(1.0f), vec3(0.5f, 0.5f, 0.5f));
 struct VertexBuffers{
 	enum{ VERTICES=0, NORMALS, INDICES, COUNT};
 
@@ -115,21 +132,89 @@ VertexBuffers vboGround;
 VertexBuffers vboTrackCon;
 
 //Geometry information
-vector<vec3> points, normals, linePoints, lineNormal, XYZPoints, XYZNormals, wheel, wheelNorm, ground, groundNorm;
-vector<vec3> negRail, posRail, posNorm, negNorm, trackConnect, trackConnectNorm; 
+vector<vec3> points, normals, linePoints, lineNormal, XYZPoints, XYZNormals, wheel, ground, groundNorm;
+vector<vec3> negRail, posRail, trackConnect;
+const vector<vec3> noNormals; //lines are not lit, their arrays have no normal buffer
 vector<unsigned int> indices, lineIndices, XYZIndices, negIndices, posIndices, wheelInd, groundInd, trackConnectInd;
 
 
-VertexBuffers vboPillar, vboPillarO;
-GLuint vaoPillar, vaoPillarO;
-vector<vec3> pillar, pillarNorm, pillarO, pillarONorm;
-vector<unsigned int> pillarInd, pillarOInd;
-
-
-vector<vec3> filePoints;
+VertexBuffers vboSupport;
+GLuint vaoSupport;
+GLuint vboSupportInstances; //one model matrix per support
+vector<vec3> column, columnNorm;
+vector<unsigned int> columnInd;
+vector<mat4> supportInstances;
+
+StreamBuffer stream; //everything written every frame: the cars' distances and the edit overlay
+vector<float> carDistances; //each car's distance round the lap, the cart and wheel arrays read it per instance
+bool carsWritten = false; //this frame's distances made it into the stream
+bool lapUploaded = false; //the lap table made it into the texture buffer the cars are placed from
+int carCount = 1; //--cars runs this many, spaced out behind the one the physics drives
+float carSpacing = 3.0f;
+
+string analyzeFile; //--analyze writes the ride profile of one lap here
+bool checkKernels = false; //--check-kernels compares the batch Frenet kernels against frenet.cpp
+float analyzeResolution = 0.001f; //arc length between ride profile samples
+
+string recordFile; //--record saves every frame's camera and play state here
+string replayFile; //--replay drives the camera and the cart from a recording instead
+string frameTimesFile; //--frame-times writes the replay's frame time percentiles here
+string baselineFile; //--baseline compares them against an earlier run's
+bool offscreen = false; //--offscreen replays with the window hidden
+bool continuous = false; //--continuous draws every frame, even when nothing has changed
+string traceFile; //--trace writes the timeline of startup, bakes and frames here, in builds with TRACE=1
+int benchRuns = 0; //--bench-bake bakes the track this many times without a window and reports each stage's counters
+bool assertNoAlloc = false; //--assert-no-alloc fails the run if a steady frame allocates, in builds with ALLOCS=1
+FrameAllocations frameAllocations;
+int quietFrames = 0; //frames drawn since the last upload or new track
+const int warmupFrames = 60; //after which frames are steady, every buffer has grown to its size
+CameraRecording recording;
+vector<float> frameTimes; //ms between buffer swaps while replaying
+
+ArcLengthTable arcTable;
+IntegratorSettings integrator;
+CartState cart; //integrated state of the cart while it runs free
+EnergyReport energyReport;
+
+
+string trackFile = "track2.txt";
+BakeSettings bakeSettings; //subdivision, lift speed and support layout of the track
+FileWatcher watcher; //track file and shader sources
+
+/* bakes run on the job threads and hand each finished stage back through uploads, declared
+ * ahead of jobs so the threads are joined before anything they post to goes away*/
+MainThreadQueue uploads;
+std::atomic<int> bakeGeneration(0); //bumped by every bake, stages of older bakes are dropped
+std::shared_ptr<TrackBake> spareBake; //the arrays of the track applyBake swapped out, the next bake fills them
+JobSystem jobs;
+bool trackReady = false; //the first bake has reached its rails, the cart can run
+bool trackChanged = false; //a bake was swapped in, the cart starts the lap again
+bool sceneDirty = true; //raised by the callbacks and whatever changes the scene, a frame is owed
+double lastChange = 0; //when it was last raised, frames go on for a while after so the follow camera settles
+const double settleTime = 0.5;
+const double idleWait = 0.1; //longest sleep while idle before looking for changed files and finished bakes
+GLuint vaoPreview; //coarse stages of the curve, drawn until the track is ready
+VertexBuffers vboPreview;
+vector<unsigned int> previewInd;
+vector<vec3> controlPoints; //the track's control polygon, linePoints is this subdivided
+vector<SectionType> controlTags; //section tag of each control point from the track file
+vector<unsigned char> trackSections; //SectionType of each point of linePoints
+vector<float> trackSpeeds; //design speed at each point of linePoints, the rails bank for these
+vector<mat3> trackFrames; //Frenet frame at each point of linePoints, baked with the rails
+LapTable lapTable; //the cart's pose round the lap, sampled from trackFrames and trackSpeeds
+
+bool editing = false; //E toggles moving the control points with the keyboard
+int selectedControl = 0;
+float editStep = 1.0f;
+GLuint vaoControl;
+VertexBuffers vboControl;
+vector<unsigned int> controlInd;
 vec3 gravity = vec3(0.0f, -9.81f, 0.0f);
 
 Camera* activeCamera;
+CameraMode cameraMode = CAMERA_ORBIT; //C cycles the trackball, riding in the cart and chasing it
+FollowCamera follow;
+Camera followView; //where follow puts the ride and chase views
 
 GLFWwindow* window = 0;
 
@@ -140,7 +225,22 @@ mat4 V;
 mat4 P;
 mat4 MXYZ = mat4(1.0f);
 
-GLuint program;
+ShaderManager shaders; //every program, cached as binaries between runs
+GLuint program; //lit by the light and its shadow maps, lines show their material's colour
+GLuint instancedProgram; //supports, one model matrix per instance
+MaterialTable materials; //surface constants for every program, loaded once
+GLuint depthProgram, depthInstancedProgram; //depth only, for the prepass and the shadow maps
+GLuint cartProgram, cartDepthProgram; //place each car from the lap table on the GPU
+LapBuffer lapBuffer;
+RailGenerator railGenerator; //builds the rails and ties on the GPU with --gpu-rails
+bool gpuRails = false;
+
+FrameGraph frameGraph; //orders the passes and their draws each frame
+int staticShadowPass, dynamicShadowPass, depthPass, opaquePass, linePass, overlayPass;
+
+ShadowMaps shadows;
+vec3 lightDirection = vec3(-0.4f, -1.0f, -0.3f);
+float cartShadowRadius = 3.0f; //the dynamic map covers this much around the cart
 // --------------------------------------------------------------------------
 // GLFW callback functions
 
@@ -154,17 +254,63 @@ void ErrorCallback(int error, const char* description)
 // handles keyboard input events
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+	sceneDirty = true;
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GL_TRUE);
     if(key == GLFW_KEY_SPACE && action == GLFW_PRESS)
     {
 		play = !play;
 	}
-
+	if(key == GLFW_KEY_C && action == GLFW_PRESS)
+	{
+		cameraMode = CameraMode((cameraMode + 1) % CAMERA_MODE_COUNT);
+		follow.reset();
+	}
+	if(key == GLFW_KEY_A && action == GLFW_PRESS && trackReady && !editing)
+		analyzeCurrentTrack();
+	if(key == GLFW_KEY_E && action == GLFW_PRESS && trackReady)
+	{
+		/* edits only rebuild what they touch, leaving the mode rebuilds the lap's sections and speeds*/
+		editing = !editing;
+		if(!editing)
+			rebuildTrack();
+		uploadControlPolygon();
+	}
+	
+	if(editing && (action == GLFW_PRESS || action == GLFW_REPEAT))
+	{
+		int count = controlPoints.size();
+		vec3 offset = vec3(0.0f);
+		
+		switch(key)
+		{
+		case GLFW_KEY_TAB:
+		case GLFW_KEY_RIGHT_BRACKET:
+			selectedControl = (selectedControl + 1) % count;
+			break;
+		case GLFW_KEY_LEFT_BRACKET:
+			selectedControl = (selectedControl + count - 1) % count;
+			break;
+		case GLFW_KEY_LEFT:		offset.x = -editStep; break;
+		case GLFW_KEY_RIGHT:	offset.x = editStep; break;
+		case GLFW_KEY_UP:		offset.z = -editStep; break;
+		case GLFW_KEY_DOWN:		offset.z = editStep; break;
+		case GLFW_KEY_PAGE_UP:	offset.y = editStep; break;
+		case GLFW_KEY_PAGE_DOWN:offset.y = -editStep; break;
+		case GLFW_KEY_S:
+			if(action == GLFW_PRESS)
+				saveTrack();
+			break;
+		}
+		
+		if(offset != vec3(0.0f))
+			moveControlPoint(selectedControl, offset);
+	}
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
+	sceneDirty = true;
 	if( (action == GLFW_PRESS) || (action == GLFW_RELEASE) ){
 		if(button == GLFW_MOUSE_BUTTON_LEFT)
 			leftmousePressed = !leftmousePressed;
@@ -175,8 +321,7 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 
 void mousePosCallback(GLFWwindow* window, double xpos, double ypos)
 {
-	int vp[4];
-	glGetIntegerv(GL_VIEWPORT, vp);
+	const int* vp = glState.getViewport();
 
 	vec2 newPos = vec2(xpos/(double)vp[2], -ypos/(double)vp[3])*2.f - vec2(1.f);
 
@@ -190,16 +335,17 @@ void mousePosCallback(GLFWwindow* window, double xpos, double ypos)
 
 		activeCamera->zoom(pow(zoomBase, abs(diff.y)));
 	}
+	if(leftmousePressed || rightmousePressed)
+		sceneDirty = true;
 
 	mousePos = newPos;
 }
 
 void resizeCallback(GLFWwindow* window, int width, int height)
 {
-	int vp[4];
-	glGetIntegerv(GL_VIEWPORT, vp);
-
-	glViewport(0, 0, width, height);
+	glState.viewport(0, 0, width, height);
+	frameGraph.screen(width, height);
+	sceneDirty = true;
 
 	float minDim = float(std::min(width, height));
 
@@ -207,6 +353,12 @@ void resizeCallback(GLFWwindow* window, int width, int height)
 	winRatio[1][1] = minDim/float(height);
 }
 
+/* the window was uncovered or otherwise needs its contents again, nothing else will ask for a frame*/
+void refreshCallback(GLFWwindow* window)
+{
+	sceneDirty = true;
+}
+
 void printVec(vec3 vector)
 {
 	cout << "X: " << vector.x << " Y: " << vector.y << " Z: " << vector.z << endl;
@@ -230,10 +382,10 @@ void printVec(vec3 vector)
 //Describe the setup of the Vertex Array Object
 bool initVAO(GLuint vao, const VertexBuffers& vbo)
 {
-	glBindVertexArray(vao);		//Set the active Vertex Array
+	glState.bindVertexArray(vao);		//Set the active Vertex Array
 
 	glEnableVertexAttribArray(0);		//Tell opengl you're using layout attribute 0 (For shader input)
-	glBindBuffer( GL_ARRAY_BUFFER, vbo.id[VertexBuffers::VERTICES] );		//Set the active Vertex Buffer
+	glState.bindBuffer( GL_ARRAY_BUFFER, vbo.id[VertexBuffers::VERTICES] );		//Set the active Vertex Buffer
 	glVertexAttribPointer(
 		0,				//Attribute
 		3,				//Size # Components
@@ -244,7 +396,7 @@ bool initVAO(GLuint vao, const VertexBuffers& vbo)
 		);
 
 	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo.id[VertexBuffers::NORMALS]);
+	glState.bindBuffer(GL_ARRAY_BUFFER, vbo.id[VertexBuffers::NORMALS]);
 	glVertexAttribPointer(
 		1,				//Attribute
 		3,				//Size # Components
@@ -254,63 +406,131 @@ bool initVAO(GLuint vao, const VertexBuffers& vbo)
 		(void*)0			//Offset
 		);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.id[VertexBuffers::INDICES]);
+	glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.id[VertexBuffers::INDICES]);
 
 	return !CheckGLErrors("initVAO");		//Check for errors in initialize
 }
 
+//Adds a per-instance model matrix to the Vertex Array Object, one vec4 column per attribute
+bool initInstanceVAO(GLuint vao, GLuint instanceBuffer)
+{
+	glState.bindVertexArray(vao);
+	glState.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	for(int c = 0; c < 4; c++)
+	{
+		glEnableVertexAttribArray(2 + c);
+		glVertexAttribPointer(
+			2 + c,					//Attribute
+			4,						//Size # Components
+			GL_FLOAT,				//Type
+			GL_FALSE,				//Normalized?
+			sizeof(mat4),			//Stride
+			(void*)(sizeof(vec4)*c)	//Offset
+			);
+		glVertexAttribDivisor(2 + c, 1);	//Advance once per instance instead of per vertex
+	}
+
+	glState.bindVertexArray(0);
+	return !CheckGLErrors("initInstanceVAO");
+}
+
+
+//Points a Vertex Array Object's attribute at this frame's data in the stream buffer, once a frame
+void pointAtStream(GLuint vao, GLuint attribute, GLint size, GLintptr offset, GLuint divisor)
+{
+	glState.bindVertexArray(vao);
+	glState.bindBuffer(GL_ARRAY_BUFFER, stream.id());
+	glEnableVertexAttribArray(attribute);
+	glVertexAttribPointer(attribute, size, GL_FLOAT, GL_FALSE, size*sizeof(float), (void*)offset);
+	glVertexAttribDivisor(attribute, divisor);
+}
 
 //Loads buffers with data
 bool loadBuffer(const VertexBuffers& vbo, 
 				const vector<vec3>& points, 
-				const vector<vec3> normals, 
+				const vector<vec3>& normals, 
 				const vector<unsigned int>& indices)
 {
 	
-	glBindBuffer(GL_ARRAY_BUFFER, vbo.id[VertexBuffers::VERTICES]);
+	glState.bindBuffer(GL_ARRAY_BUFFER, vbo.id[VertexBuffers::VERTICES]);
 	glBufferData(
 		GL_ARRAY_BUFFER,				//Which buffer you're loading too
 		sizeof(vec3)*points.size(),		//Size of data in array (in bytes)
-		&points[0],						//Start of array (&points[0] will give you pointer to start of vector)
+		points.empty() ? 0 : &points[0],	//Start of array (&points[0] will give you pointer to start of vector)
 		GL_STATIC_DRAW					//GL_DYNAMIC_DRAW if you're changing the data often
 										//GL_STATIC_DRAW if you're changing seldomly
 		);
 
-	glBindBuffer(GL_ARRAY_BUFFER, vbo.id[VertexBuffers::NORMALS]);
-	glBufferData(
-		GL_ARRAY_BUFFER,				//Which buffer you're loading too
-		sizeof(vec3)*normals.size(),	//Size of data in array (in bytes)
-		&normals[0],					//Start of array (&points[0] will give you pointer to start of vector)
-		GL_STATIC_DRAW					//GL_DYNAMIC_DRAW if you're changing the data often
-										//GL_STATIC_DRAW if you're changing seldomly
-		);
+	if(!normals.empty())
+	{
+		glState.bindBuffer(GL_ARRAY_BUFFER, vbo.id[VertexBuffers::NORMALS]);
+		glBufferData(
+			GL_ARRAY_BUFFER,				//Which buffer you're loading too
+			sizeof(vec3)*normals.size(),	//Size of data in array (in bytes)
+			&normals[0],					//Start of array (&points[0] will give you pointer to start of vector)
+			GL_STATIC_DRAW					//GL_DYNAMIC_DRAW if you're changing the data often
+											//GL_STATIC_DRAW if you're changing seldomly
+			);
+	}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.id[VertexBuffers::INDICES]);
+	glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.id[VertexBuffers::INDICES]);
 	glBufferData(
 		GL_ELEMENT_ARRAY_BUFFER,
 		sizeof(unsigned int)*indices.size(),
-		&indices[0],
+		indices.empty() ? 0 : &indices[0],
 		GL_STATIC_DRAW
 		);
 
 	return !CheckGLErrors("loadBuffer");	
 }
 
-//Compile and link shaders, storing the program ID in shader array
-GLuint initShader(string vertexName, string fragmentName)
-{	
-	string vertexSource = LoadSource(vertexName);		//Put vertex file text into string
-	string fragmentSource = LoadSource(fragmentName);		//Put fragment file text into string
+//Loads a mesh once, with its Vertex Array bound so the index buffer is attached to it.
+//A mesh without normals reads the default (0, 0, 0) instead of an empty buffer
+bool uploadMesh(GLuint vao, const VertexBuffers& vbo,
+				const vector<vec3>& points,
+				const vector<vec3>& normals,
+				const vector<unsigned int>& indices)
+{
+	TRACE_ZONE("uploadMesh");
+	glState.bindVertexArray(vao);
+	if(normals.empty())
+		glDisableVertexAttribArray(1);
+	else
+		glEnableVertexAttribArray(1);
+	bool loaded = loadBuffer(vbo, points, normals, indices);
+	glState.bindVertexArray(0);
+	return loaded;
+}
 
-	GLuint vertexID = CompileShader(GL_VERTEX_SHADER, vertexSource);
-	GLuint fragmentID = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
-	
-	return LinkProgram(vertexID, fragmentID);	//Link and store program ID in shader array
+//Loads only the index buffer, for arrays whose vertices are written on the GPU
+void uploadIndices(GLuint vao, const VertexBuffers& vbo, const vector<unsigned int>& indices)
+{
+	glState.bindVertexArray(vao);
+	glDisableVertexAttribArray(1);
+	glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.id[VertexBuffers::INDICES]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)*indices.size(), indices.empty() ? 0 : &indices[0], GL_STATIC_DRAW);
+	glState.bindVertexArray(0);
+}
+
+//Replaces count entries of an already loaded buffer from first on, in two parts if the range wraps past the end
+void updateBufferRange(GLuint buffer, const vector<vec3>& data, int first, int count)
+{
+	int n = data.size();
+	first = ((first % n) + n) % n;
+	count = std::min(count, n);
+	int tail = std::min(count, n - first);
+
+	glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(vec3)*first, sizeof(vec3)*tail, &data[first]);
+	if(count > tail)
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vec3)*(count - tail), &data[0]);
 }
 
 //Initialization
 void initGL()
 {
+	TRACE_ZONE("initGL");
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
 
@@ -321,7 +541,7 @@ void initGL()
 
 bool loadUniforms(GLuint program, mat4 perspective, mat4 modelview)
 {
-	glUseProgram(program);
+	glState.useProgram(program);
 
 	glUniformMatrix4fv(glGetUniformLocation(program, "modelviewMatrix"),
 						1,
@@ -333,96 +553,223 @@ bool loadUniforms(GLuint program, mat4 perspective, mat4 modelview)
 						false,
 						&perspective[0][0]);
 
-	glUseProgram(0);
+	glState.useProgram(0);
 	return !CheckGLErrors("loadUniforms");
 }
 
-/* used for rendering the cart */
-void render()
+/* the passes of a frame, from what they read and write the graph works out their order*/
+void setupFrameGraph()
 {
-	glBindVertexArray(vao);		//Use the LINES vertex array
-	glUseProgram(program);
-
-	loadBuffer(vbo, points, normals, indices);
-
-	glDrawElements(
-			GL_TRIANGLES,		//What shape we're drawing	- GL_TRIANGLES, GL_LINES, GL_POINTS, GL_QUADS, GL_TRIANGLE_STRIP
-			indices.size(),		//How many indices
-			GL_UNSIGNED_INT,	//Type
-			(void*)0			//Offset
-			);
-
-	CheckGLErrors("render");
-	glUseProgram(0);
-	glBindVertexArray(0);
+	TRACE_ZONE("setupFrameGraph");
+	PassState depthOnly;
+	depthOnly.colourWrite = false;
+	
+	/* the static map is only given draws when the track moved, other frames it is skipped
+	 * and keeps what it has*/
+	staticShadowPass = frameGraph.addPass("static shadow", depthOnly);
+	frameGraph.writes(staticShadowPass, "static shadow");
+	frameGraph.target(staticShadowPass, shadows.staticFramebuffer(), shadows.staticResolution(), shadows.staticResolution(), true);
+	
+	dynamicShadowPass = frameGraph.addPass("dynamic shadow", depthOnly);
+	frameGraph.writes(dynamicShadowPass, "dynamic shadow");
+	frameGraph.target(dynamicShadowPass, shadows.dynamicFramebuffer(), shadows.dynamicResolution(), shadows.dynamicResolution(), true);
+	
+	depthPass = frameGraph.addPass("depth prepass", depthOnly);
+	frameGraph.writes(depthPass, "depth");
+	
+	/* the prepass already laid down the depth of every opaque surface*/
+	PassState shade;
+	shade.depthWrite = false;
+	opaquePass = frameGraph.addPass("opaque", shade);
+	frameGraph.reads(opaquePass, "depth");
+	frameGraph.reads(opaquePass, "static shadow");
+	frameGraph.reads(opaquePass, "dynamic shadow");
+	frameGraph.writes(opaquePass, "colour");
+	
+	linePass = frameGraph.addPass("lines", PassState());
+	frameGraph.reads(linePass, "depth");
+	frameGraph.writes(linePass, "depth");
+	frameGraph.writes(linePass, "colour");
+	
+	PassState onTop;
+	onTop.depthTest = false;
+	overlayPass = frameGraph.addPass("overlay", onTop);
+	frameGraph.writes(overlayPass, "colour");
 }
-/*renders the pillars*/
-void renderPillar(GLuint vao, VertexBuffers vbo, vector<vec3> points, vector<vec3> normal, vector<unsigned int> indices)
-{
-	glBindVertexArray(vao);		//Use the LINES vertex array
-	glUseProgram(program);
 
-	loadBuffer(vbo, points, normal, indices);
-
-	glDrawElements(
-			GL_TRIANGLES,		//What shape we're drawing	- GL_TRIANGLES, GL_LINES, GL_POINTS, GL_QUADS, GL_TRIANGLE_STRIP
-			indices.size(),		//How many indices
-			GL_UNSIGNED_INT,	//Type
-			(void*)0			//Offset
-			);
+/* opaque meshes are shaded with the lit program, their prepass uses the depth only one*/
+void submitOpaque(DrawItem draw, GLuint depthOnly)
+{
+	frameGraph.submit(opaquePass, draw);
+	draw.program = depthOnly;
+	frameGraph.submit(depthPass, draw);
+}
 
-	CheckGLErrors("render");
-	glUseProgram(0);
-	glBindVertexArray(0);
+/* fits the static shadow map around the track and the ground under it, it is drawn again next frame*/
+void fitStaticShadow()
+{
+	if(linePoints.empty())
+		return;
+	
+	vec3 lo = linePoints[0], hi = linePoints[0];
+	for(int i = 1; i < (int)linePoints.size(); i++)
+	{
+		lo = min(lo, linePoints[i]);
+		hi = max(hi, linePoints[i]);
+	}
+	lo.y = std::min(lo.y, bakeSettings.groundHeight);
+	
+	shadows.fitStatic(0.5f*(lo + hi), 0.5f*length(hi - lo) + 1.0f);
+	frameGraph.setViewProjection(staticShadowPass, shadows.staticMatrix());
 }
-/*renders the ground*/
-void renderGround(GLuint vao, VertexBuffers vbo, vector<vec3> points, vector<vec3> normal, vector<unsigned int> indices)
+
+/* follows the cars with the dynamic map and loads the light and the eye into the lit programs*/
+void prepareLighting(vec3 eye)
 {
-	glBindVertexArray(vao);		//Use the LINES vertex array
-	glUseProgram(program);
+	TRACE_ZONE("prepareLighting");
+	/* every car casts into the dynamic map, so it covers the lot of them*/
+	vec3 lo = vec3(M[3]), hi = lo;
+	if(trackReady)
+		for(int c = 0; c < (int)carDistances.size(); c++)
+		{
+			vec3 p = lapTable.sample(carDistances[c]).position + vec3(0.0f, 1.0f, 0.0f);
+			lo = min(lo, p);
+			hi = max(hi, p);
+		}
+	shadows.fitDynamic(0.5f*(lo + hi), 0.5f*length(hi - lo) + cartShadowRadius);
+	frameGraph.setViewProjection(dynamicShadowPass, shadows.dynamicMatrix());
+	shadows.bindTextures();
+	
+	GLuint lit[3] = {program, instancedProgram, cartProgram};
+	for(int p = 0; p < 3; p++)
+	{
+		glState.useProgram(lit[p]);
+		shadows.loadUniforms(lit[p]);
+		glUniform3fv(glState.uniformLocation(lit[p], "cameraPosition"), 1, &eye[0]);
+	}
+}
 
-	loadBuffer(vbo, points, normal, indices);
+/* the programs read their materials from the one uniform buffer*/
+void attachMaterials()
+{
+	GLuint all[6] = {program, instancedProgram, depthProgram, depthInstancedProgram, cartProgram, cartDepthProgram};
+	for(int p = 0; p < 6; p++)
+		materials.attach(all[p]);
+}
 
-	glDrawElements(
-			GL_TRIANGLES,		//What shape we're drawing	- GL_TRIANGLES, GL_LINES, GL_POINTS, GL_QUADS, GL_TRIANGLE_STRIP
-			indices.size(),		//How many indices
-			GL_UNSIGNED_INT,	//Type
-			(void*)0			//Offset
-			);
+/* every car's distance, the lead car's is the physics', the rest follow it round*/
+void spaceCars()
+{
+	float spacing = std::min(carSpacing, arcTable.total/carCount);
+	carDistances.resize(carCount);
+	for(int c = 0; c < carCount; c++)
+		carDistances[c] = arcTable.wrapDistance(lapDistance - c*spacing);
+}
 
-	CheckGLErrors("render");
-	glUseProgram(0);
-	glBindVertexArray(0);
+/* loads every car's distance into the stream, the cars aren't drawn without the lap table*/
+void prepareCars()
+{
+	TRACE_ZONE("prepareCars");
+	carsWritten = false;
+	if(!lapUploaded)
+		return;
+	
+	GLintptr offset = stream.write(&carDistances[0], sizeof(float)*carDistances.size());
+	carsWritten = offset >= 0;
+	if(!carsWritten)
+		return;
+	pointAtStream(vao, 2, 1, offset, 1);
+	pointAtStream(vaoWheel, 2, 1, offset, 1);
+	
+	lapBuffer.bindTexture();
+	GLuint placed[2] = {cartProgram, cartDepthProgram};
+	for(int p = 0; p < 2; p++)
+	{
+		glState.useProgram(placed[p]);
+		lapBuffer.loadUniforms(placed[p]);
+	}
 }
 
-/*renders the track*/
-void renderLine(GLuint vao, VertexBuffers vbo, vector<vec3> points, vector<vec3> normal, vector<unsigned int> indices)
+/* hands every draw of the frame to the frame graph, the buffers are all loaded already*/
+void submitScene()
 {
-	glBindVertexArray(vao);
-	glUseProgram(program);
+	TRACE_ZONE("submitScene");
+	mat4 groundModel = scale(mat4(1.0f), vec3(25.0f, 3.0f, 30.0f));
+	DrawItem supports(instancedProgram, vaoSupport, GL_TRIANGLES, columnInd.size(), MATERIAL_SUPPORT);
+	supports.instances = supportInstances.size();
 	
+	if(trackReady)
+	{
+		if(carsWritten)
+		{
+			/* the cars place themselves, the models put the body above the track and the wheels
+			 * beside it in each car's own frame*/
+			DrawItem cart(cartProgram, vao, GL_TRIANGLES, indices.size(), MATERIAL_CART, scale(mat4(1.0f), vec3(0.75f)));
+			cart.instances = carCount;
+			cart.worldOffset = vec3(0.0f, 1.0f, 0.0f);
+			DrawItem wheelR(cartProgram, vaoWheel, GL_LINES, wheelInd.size(), MATERIAL_WHEEL, translate(mat4(1.0f), vec3(0.5f, 0.0f, 0.0f)));
+			wheelR.instances = carCount;
+			DrawItem wheelL = wheelR;
+			wheelL.model = translate(mat4(1.0f), vec3(-2.5f, 0.0f, 0.0f));
+		
+			submitOpaque(cart, cartDepthProgram);
+			cart.program = wheelR.program = wheelL.program = cartDepthProgram;
+			frameGraph.submit(dynamicShadowPass, cart);
+			frameGraph.submit(dynamicShadowPass, wheelR);
+			frameGraph.submit(dynamicShadowPass, wheelL);
+			wheelR.program = wheelL.program = cartProgram;
+			frameGraph.submit(linePass, wheelR);
+			frameGraph.submit(linePass, wheelL);
+		}
+		
+		if(shadows.staticDirty())
+		{
+			DrawItem staticCaster = supports;
+			staticCaster.program = depthInstancedProgram;
+			if(staticCaster.instances > 0)
+				frameGraph.submit(staticShadowPass, staticCaster);
+			frameGraph.submit(staticShadowPass, DrawItem(depthProgram, vaoGround, GL_TRIANGLES, groundInd.size(), MATERIAL_GROUND, groundModel));
+			frameGraph.submit(staticShadowPass, DrawItem(depthProgram, vaoNeg, GL_LINES, negIndices.size(), MATERIAL_RAIL));
+			frameGraph.submit(staticShadowPass, DrawItem(depthProgram, vaoPos, GL_LINES, posIndices.size(), MATERIAL_RAIL));
+			frameGraph.submit(staticShadowPass, DrawItem(depthProgram, vaoTrackCon, GL_LINES, trackConnectInd.size(), MATERIAL_TIE));
+			shadows.staticDrawn();
+		}
+	}
+	else
+		frameGraph.submit(linePass, DrawItem(program, vaoPreview, GL_LINES, previewInd.size(), MATERIAL_PREVIEW));
 	
-	loadBuffer(vbo, points, normal, indices);
-	
-
-	glDrawElements(
-			GL_LINES,
-			indices.size(),
-			GL_UNSIGNED_INT,
-			(void*)0
-			);
-	
+	submitOpaque(DrawItem(program, vaoGround, GL_TRIANGLES, groundInd.size(), MATERIAL_GROUND, groundModel), depthProgram);
+	if(supports.instances > 0)
+		submitOpaque(supports, depthInstancedProgram);
 	
+	frameGraph.submit(linePass, DrawItem(program, vaoNeg, GL_LINES, negIndices.size(), MATERIAL_RAIL));
+	frameGraph.submit(linePass, DrawItem(program, vaoPos, GL_LINES, posIndices.size(), MATERIAL_RAIL));
+	frameGraph.submit(linePass, DrawItem(program, vaoTrackCon, GL_LINES, trackConnectInd.size(), MATERIAL_TIE));
 	
-	CheckGLErrors("renderLineTest");
-	glUseProgram(0);
-	glBindVertexArray(0);
+	/* the control polygon stays visible through the track while editing, it is written
+	 * again every frame so a moved point shows straight away*/
+	GLintptr controlOffset = (editing && !controlPoints.empty()) ? stream.write(&controlPoints[0], sizeof(vec3)*controlPoints.size()) : -1;
+	if(controlOffset >= 0)
+	{
+		pointAtStream(vaoControl, 0, 3, controlOffset, 0);
+		frameGraph.submit(overlayPass, DrawItem(program, vaoControl, GL_LINES, controlInd.size(), MATERIAL_CONTROL));
+		DrawItem controls(program, vaoControl, GL_POINTS, controlPoints.size(), MATERIAL_CONTROL);
+		controls.indexed = false;
+		controls.pointSize = 8.0f;
+		frameGraph.submit(overlayPass, controls);
+		
+		DrawItem selected(program, vaoControl, GL_POINTS, 1, MATERIAL_SELECTED);
+		selected.indexed = false;
+		selected.first = selectedControl;
+		selected.pointSize = 10.0f;
+		frameGraph.submit(overlayPass, selected);
+	}
 }
 /* XYZ framework of the cube*/
 void renderXYZ()
 {
-	glBindVertexArray(vaoLine);
-	glUseProgram(program);
+	glState.bindVertexArray(vaoLine);
+	glState.useProgram(program);
 	
 	
 	loadBuffer(vboLine, XYZPoints, XYZNormals, XYZIndices);
@@ -438,24 +785,19 @@ void renderXYZ()
 	
 	
 	CheckGLErrors("renderLine");
-	glUseProgram(0);
-	glBindVertexArray(0);
+	glState.useProgram(0);
+	glState.bindVertexArray(0);
 	
 }
 /* generates the wheels*/
-void generateWheel(vector<vec3>* vertices, vector<vec3>* normals, 
-					vector<unsigned int>* indices, float width)
+/* the wheel is drawn as lines, so it has no normals*/
+void generateWheel(vector<vec3>* vertices, vector<unsigned int>* indices)
 {
 	vertices->push_back(vec3(1.0f, 1.0f, 0.f));
 	vertices->push_back(vec3(1.0f, 1.0f, -1.0f));
 	vertices->push_back(vec3(1.0f, 0.0f, -1.0f));
 	vertices->push_back(vec3(1.0f, 0.0f, 0.0f));
 
-	normals->push_back(vec3(1.f, 1.f, 1.f));
-	normals->push_back(vec3(1.f, 1.f, 1.f));
-	normals->push_back(vec3(1.f, 1.f, 1.f));
-	normals->push_back(vec3(1.f, 1.f, 1.f));
-	
 	indices->push_back(0);
 	indices->push_back(1);
 	
@@ -480,10 +822,8 @@ void generateSquare(vector<vec3>* vertices, vector<vec3>* normals,
 	vertices->push_back(vec3(3.0f, -1.0f, 3.0f));
 	vertices->push_back(vec3(-3.0f, -1.0f, 3.0f));
 
-	normals->push_back(vec3(0.0f, 0.3f, 0.0f));
-	normals->push_back(vec3(0.0f, 0.2f, 0.0f));
-	normals->push_back(vec3(0.0f, 0.4f, 0.0f));
-	normals->push_back(vec3(0.0f, 0.6f, 0.0f));
+	for(int i = 0; i < 4; i++)
+		normals->push_back(vec3(0.0f, 1.0f, 0.0f));
 
 	//First triangle
 	indices->push_back(0);
@@ -493,190 +833,13 @@ void generateSquare(vector<vec3>* vertices, vector<vec3>* normals,
 	indices->push_back(2);
 	indices->push_back(3);
 	indices->push_back(0);
-}
-/*generates the pillar to "hold the track up"*/
-void generatePillar(vector<vec3>* vertices, vector<vec3>* normals,
-			vector<unsigned int>* indices, vec3 highPoint, vec3 lowPoint)
-{
-	float xH = highPoint.x;
-	float yH = highPoint.y;
-	float zH = highPoint.z;
-	
-	
-	float xL = xH;
-	float yL = yH-yH-3.0f;
-	float zL = zH;
-	float inc = 0.75f;
-	lowPoint = vec3(xL,yL,zL);
-	vertices->push_back(highPoint); //0
-	vertices->push_back(vec3(xH + inc, yH, zH)); //1
-	vertices->push_back(vec3(xH + inc, yH, zH + inc)); //2
-	vertices->push_back(vec3(xH, yH, zH + inc)); //3
-	
-	vertices->push_back(lowPoint); //0
-	vertices->push_back(vec3(xL + inc, yL, zL)); //1
-	vertices->push_back(vec3(xL + inc, yL, zL + inc)); //2
-	vertices->push_back(vec3(xL, yL, zL + inc)); //3
-	
-	normals->push_back(vec3(0.5f, 0.5f, 0.0f));
-	normals->push_back(vec3(0.5f, 0.5f, 0.0f));
-	normals->push_back(vec3(0.5f, 0.5f, 0.0f));
-	normals->push_back(vec3(0.5f, 0.5f, 0.0f));
-	
-	normals->push_back(vec3(0.5f, 0.5f, 0.0f));
-	normals->push_back(vec3(0.5f, 0.5f, 0.0f));
-	normals->push_back(vec3(0.5f, 0.5f, 0.0f));
-	normals->push_back(vec3(0.5f, 0.5f, 0.0f));
-	
-	/*TOP*/
-	indices->push_back(0);
-	indices->push_back(2);
-	indices->push_back(3);
-	
-	indices->push_back(0);
-	indices->push_back(1);
-	indices->push_back(2);
-	
-	/*left*/
-	indices->push_back(0);
-	indices->push_back(3);
-	indices->push_back(4);
-	
-	indices->push_back(3);
-	indices->push_back(4);
-	indices->push_back(5);
-	
-	/*Right*/
-	indices->push_back(1);
-	indices->push_back(2);
-	indices->push_back(7);
-	
-	indices->push_back(2);
-	indices->push_back(6);
-	indices->push_back(7);
-	
-	/*Back*/
-	indices->push_back(0);
-	indices->push_back(1);
-	indices->push_back(4);
-	
-	indices->push_back(1);
-	indices->push_back(4);
-	indices->push_back(7);
-	
-	/*Front*/
-	indices->push_back(2);
-	indices->push_back(3);
-	indices->push_back(5);
-	
-	indices->push_back(2);
-	indices->push_back(5);
-	indices->push_back(6);
-	
-	/*Bottom*/
-	indices->push_back(4);
-	indices->push_back(5);
-	indices->push_back(6);
-	
-	indices->push_back(5);
-	indices->push_back(6);
-	indices->push_back(7);
-	
-	
-	
-	
-	
-	
 }
 /*generates the cart*/
 void generateCube(vector<vec3>* vertices, vector<vec3>* normals, 
 					vector<unsigned int>* indices, float width)
 {
-/* points for generating the cube*/
-vertices->push_back(vec3(1.0f, 1.0f, 1.f)); //0
-vertices->push_back(vec3(1.0f, -1.0f, 1.f)); //1
-vertices->push_back(vec3(-1.0f, -1.0f, 1.f)); //2
-vertices->push_back(vec3(-1.0f, 1.0f, 1.f)); //3
-vertices->push_back(vec3(-1.0f, -1.0f, -1.f)); //4
-vertices->push_back(vec3(-1.0f, 1.0f, -1.f)); //5
-vertices->push_back(vec3(1.0f, 1.0f, -1.f)); //6
-vertices->push_back(vec3(1.0f, -1.0f, -1.f)); //7
-
-
-
-/* front of cube*/
-indices->push_back(0);
-indices->push_back(1);
-indices->push_back(2);
-
-indices->push_back(0);
-indices->push_back(2);
-indices->push_back(3);
-
-/* left side of cube*/
-indices->push_back(2);
-indices->push_back(3);
-indices->push_back(4);
-
-indices->push_back(3);
-indices->push_back(4);
-indices->push_back(5);
-
-/* back of cube*/
-indices->push_back(6);
-indices->push_back(7);
-indices->push_back(4);
-
-indices->push_back(4);
-indices->push_back(5);
-indices->push_back(6);
-
-/* right side of cube*/
-indices->push_back(0);
-indices->push_back(1);
-indices->push_back(7);
-
-indices->push_back(0);
-indices->push_back(7);
-indices->push_back(6);
-
-/* top of cube*/
-indices->push_back(0);
-indices->push_back(3);
-indices->push_back(5);
-
-indices->push_back(0);
-indices->push_back(5);
-indices->push_back(6);
-
-/* bottom of cube*/
-indices->push_back(1);
-indices->push_back(2);
-indices->push_back(4);
-
-indices->push_back(1);
-indices->push_back(4);
-indices->push_back(7);
-
-
-
-/*colors of each point*/
-
-normals->push_back(vec3(0.9f, 0.0f, 0.f));
-normals->push_back(vec3(0.7f, 0.0f, 0.f));
-normals->push_back(vec3(0.5f, 0.0f, 0.f));
-normals->push_back(vec3(0.3f, 0.0f, 0.f));
-
-normals->push_back(vec3(0.9f, 0.0f, 0.f));
-normals->push_back(vec3(0.7f, 0.0f, 0.f));
-normals->push_back(vec3(0.5f, 0.0f, 0.f));
-normals->push_back(vec3(0.3f, 0.0f, 0.f));
-
-
-
-
-
-	
+	/* each face has its own four corners so the normals are flat*/
+	generateBox(vec3(-1.0f), vec3(1.0f), vertices, normals, indices);
 }
 /*generates the XYZ coordframe of the cart*/
 void generateSquareXYZCoords(vector<vec3>* vertices, vector<vec3>* normals, 
@@ -702,36 +865,6 @@ void generateSquareXYZCoords(vector<vec3>* vertices, vector<vec3>* normals,
 	indices->push_back(0);
 	indices->push_back(3);
 	
-}
-/* generates the track*/
-void generateLine(vector<vec3>* vertices, vector<vec3>* normals, 
-					vector<unsigned int>* indices)
-{
-	
-	for(int i = 0; i < filePoints.size()-1; i++)
-	{
-		vertices->push_back(filePoints[i]);
-	}
-
-	normals->push_back(vec3(0.f, 1.f, 0.f));
-	normals->push_back(vec3(1.f, 0.f, 0.f));
-	normals->push_back(vec3(0.f, 1.f, 0.f));
-	normals->push_back(vec3(1.f, 0.f, 0.f));
-	
-	//line 1
-	indices->push_back(0);
-	indices->push_back(1);
-	//line 2
-	indices->push_back(1);
-	indices->push_back(2);
-	//line 3
-	indices->push_back(2);
-	indices->push_back(3);
-	//line 4
-	indices->push_back(3);
-	indices->push_back(0);
-	
-
 }
 GLFWwindow* createGLFWWindow()
 {
@@ -747,6 +880,8 @@ GLFWwindow* createGLFWWindow()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (offscreen)
+        glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
     window = glfwCreateWindow(1024, 1024, "OpenGL Example", 0, 0);
     if (!window) {
         cout << "Program failed to create GLFW window, TERMINATING" << endl;
@@ -759,6 +894,7 @@ GLFWwindow* createGLFWWindow()
     glfwSetMouseButtonCallback(window, mouseButtonCallback);
     glfwSetCursorPosCallback(window, mousePosCallback);
     glfwSetWindowSizeCallback(window, resizeCallback);
+    glfwSetWindowRefreshCallback(window, refreshCallback);
     glfwMakeContextCurrent(window);
 
     return window;
@@ -787,16 +923,25 @@ void deleteStuff()
 	glDeleteVertexArrays(1,&vaoWheel);
 	glDeleteBuffers(VertexBuffers::COUNT, vboWheel.id);
 	
-	glDeleteVertexArrays(1,&vaoPillar);
-	glDeleteBuffers(VertexBuffers::COUNT, vboPillar.id);
-	
-	glDeleteVertexArrays(1,&vaoPillarO);
-	glDeleteBuffers(VertexBuffers::COUNT, vboPillarO.id);
+	glDeleteVertexArrays(1,&vaoSupport);
+	glDeleteBuffers(VertexBuffers::COUNT, vboSupport.id);
+	glDeleteBuffers(1, &vboSupportInstances);
 	
 	glDeleteVertexArrays(1,&vaoTrackCon);
 	glDeleteBuffers(VertexBuffers::COUNT, vboTrackCon.id);
 	
-	glDeleteProgram(program);
+	glDeleteVertexArrays(1,&vaoControl);
+	glDeleteBuffers(VertexBuffers::COUNT, vboControl.id);
+	
+	glDeleteVertexArrays(1,&vaoPreview);
+	glDeleteBuffers(VertexBuffers::COUNT, vboPreview.id);
+	
+	shaders.release();
+	shadows.release();
+	materials.release();
+	lapBuffer.release();
+	railGenerator.release();
+	stream.release();
 }
 
 // ==========================================================================
@@ -814,176 +959,231 @@ float totalDistance(vector<vec3>points)
 	
 	return tot;
 }
-/* finds the highest point on the curve*/
-float highestPoint(vector<vec3> points)
+/* the cart's speed at point i, from the lap's precomputed speeds. The free sections are
+ * integrated, the speed they leave with carries on through the brakes until they take it off*/
+float cartSpeed(int i)
 {
-	float H = -1;
-	float h;
-	for(int i = 0; i < linePoints.size(); i++)
+	bool free = trackSections[i] == SECTION_FREE;
+	if(free && !cartFree)
 	{
-		h = linePoints[i].y;
-		
-		if(H < h)
-		{
-			H = h;
-			highestPointIndex = i;
-		}
+		cart.s = lapDistance;
+		cart.v = trackSpeeds[i];
+		energyReport.begin(arcTable, integrator, &cart);
 	}
-	
-	return H;
-}
-/*find the lowest point on the curve*/
-float lowestPoint(vector<vec3> points)
-{
-	float L = 10000000;
-	float l;
-	
-	for(int i = 0; i < linePoints.size(); i++)
+	else if(!free && cartFree)
 	{
-		l = linePoints[i].y;
-		
-	
-		if(L > l)
-		{
-			
-			L = l;
-			lowestPointIndex = i;
-		}
-		distLow += getLength(linePoints[i]);
+		energyReport.print(arcTable, integrator, cart);
+		brakeExcess = cart.v - trackSpeeds[i];
+		brakeEntry = trackSpeeds[i];
 	}
+	cartFree = free;
 	
-	return L;
-}
-/* sets the point to start deceleration at*/
-float decelPoint(vector<vec3>points, float low)
-{
-	float nextH;
-	float h;
-	
-	for(int i = 0; i < points.size(); i++)
-	{
-		h = points[i].y;
-		nextH = points[wrap(i+1)].y;
-		if(h == nextH && h == low)
-			return i;
-		
-	}
+	if(free)
+		return cart.v;
 	
+	/* the excess fades as the brakes bring the design speed down to the station's*/
+	float station = bakeSettings.stationSpeed;
+	if(trackSections[i] == SECTION_BRAKE && brakeEntry > station)
+		return std::max(trackSpeeds[i] + brakeExcess*(trackSpeeds[i] - station)/(brakeEntry - station), minCrawlSpeed);
 	
+	return trackSpeeds[i];
 }
-/*sets the starting point*/
-int zeroHeight(vector<vec3> points, float low)
+
+/* --analyze <file> [--resolution <m>] [--integrator euler|rk4] [--friction <mu>] [--drag <c>] [--check-kernels] [--cars <n>] [--gpu-rails]
+ * [--bench-bake <runs>] [--assert-no-alloc]*/
+void parseArguments(int argc, char *argv[])
 {
-	float nextH;
-	int startPoint = 0;
-	float h; 
-	for(int i = 0; i < points.size(); i++)
+	for(int a = 1; a < argc; a++)
 	{
-		h = points[i].y;
-		nextH = points[wrap(i+1)].y;//wrap(i+1, points).y;
-		if(h < nextH && h == low)
-		{
-			startPoint = i;
-			break;
-		}
+		string arg = argv[a];
+		if(arg == "--analyze" && a + 1 < argc)
+			analyzeFile = argv[++a];
+		else if(arg == "--resolution" && a + 1 < argc)
+			analyzeResolution = atof(argv[++a]);
+		else if(arg == "--integrator" && a + 1 < argc)
+			integrator.type = (string(argv[++a]) == "euler") ? SEMI_IMPLICIT_EULER : RK4;
+		else if(arg == "--friction" && a + 1 < argc)
+			integrator.friction = atof(argv[++a]);
+		else if(arg == "--drag" && a + 1 < argc)
+			integrator.drag = atof(argv[++a]);
+		else if(arg == "--check-kernels")
+			checkKernels = true;
+		else if(arg == "--record" && a + 1 < argc)
+			recordFile = argv[++a];
+		else if(arg == "--replay" && a + 1 < argc)
+			replayFile = argv[++a];
+		else if(arg == "--frame-times" && a + 1 < argc)
+			frameTimesFile = argv[++a];
+		else if(arg == "--baseline" && a + 1 < argc)
+			baselineFile = argv[++a];
+		else if(arg == "--offscreen")
+			offscreen = true;
+		else if(arg == "--continuous")
+			continuous = true;
+		else if(arg == "--trace" && a + 1 < argc)
+			traceFile = argv[++a];
+		else if(arg == "--bench-bake" && a + 1 < argc)
+			benchRuns = std::max(atoi(argv[++a]), 1);
+		else if(arg == "--assert-no-alloc")
+			assertNoAlloc = true;
+		else if(arg == "--cars" && a + 1 < argc)
+			carCount = std::max(atoi(argv[++a]), 1);
+		else if(arg == "--gpu-rails")
+			gpuRails = true;
+		else
+			cout << "Unknown argument " << arg << endl;
 	}
-	return startPoint;
 }
 
-/*get the distance from the deceleration point to the start point*/
-float distanceDecToStart(vector<vec3> points, int startIndex, int decIndex)
+/* the ride profile of one lap of the track file, with no window or GL so batch runs can
+ * evaluate tracks. The curve, speeds and start are the ones a bake of the file gives*/
+bool analyzeTrack()
 {
-	float totalDistance = 0;
-	for(int i = decIndex; i <= startIndex; i++)
-	{
-		totalDistance += getLength(points[wrap(i+1)] - points[wrap(i)]);
-	}
-	
-	return totalDistance;
+	vector<vec3> control;
+	vector<SectionType> tags;
+	if(!readTrackFile(trackFile, &control, &tags) || control.size() < 3)
+		return false;
+	tags.resize(control.size(), SECTION_UNTAGGED);
+	BakeSettings settings = bakeSettings;
+	settings.gravity = gravity;
+
+	vector<vec3> curve;
+	subdivideCurve(control, settings.levels, &curve);
+	vector<unsigned char> pointSections = assignSections(curve, tags, settings.levels);
+	TrackSections sections = findSections(curve, pointSections);
+	vector<float> speeds = designSpeeds(curve, pointSections, sections, settings);
+	if(checkKernels)
+		checkFrenetKernels(curve, speeds, gravity, 1e-4f);
+
+	RideProfile profile;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if(!analyzeLap(curve, speeds, sections.startPoint, analyzeResolution, &profile))
+		return false;
+	cout << "Ride analysis took " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+	printRideSummary(profile);
+	return writeRideProfile(analyzeFile, profile);
 }
-/*calculates the velocity with the law of conservation of energy*/
-float velocity(float h)
+
+/* A in the viewer prints the ride summary of the track as it is now, edits included*/
+void analyzeCurrentTrack()
 {
-	float v = sqrt(2.0f * -1.0f * gravity.y * (H-h));
-	
-	return v;
+	RideProfile profile;
+	if(analyzeLap(linePoints, trackSpeeds, startPoint, analyzeResolution, &profile))
+		printRideSummary(profile);
 }
-/* reads the track points from a file*/
-void readFile()
-{
-	ifstream myFile;
-	
-	float x,y,z;
-	vec3 input;
-	
 
-	//myFile.open("trackCoords.txt");
-	myFile.open("track2.txt");
-	if(myFile.is_open())
+/* one stage of the bake benchmark, counted by the hardware counters and the allocation tracker*/
+struct BenchStage{
+	PerfStage perf;
+	AllocationStage allocations;
+
+	BenchStage(PerfCounters& counters, const char* name): perf(counters, name), allocations(name){}
+};
+
+/* runs the stages of bakeTrack on the track file runs times, with no window or GL, and reports
+ * the time and hardware counters of each. The stages take the same inputs as in a bake*/
+bool benchBake(int runs)
+{
+	vector<vec3> control;
+	vector<SectionType> tags;
+	if(!readTrackFile(trackFile, &control, &tags) || control.size() < 3)
+		return false;
+	tags.resize(control.size(), SECTION_UNTAGGED);
+	BakeSettings settings = bakeSettings;
+	settings.gravity = gravity;
+
+	PerfCounters counters;
+	counters.open();
+	int n = 0;
+	for(int r = 0; r < runs; r++)
 	{
-		while(!myFile.eof())
+		TrackBake bake;
 		{
-			myFile >> x >> y >> z;
-			filePoints.push_back(vec3(x,y,z));
-			
-		}	
-	}
-	else
-	{
-		cout << "File not opened" << endl;
-	}
-	
-	myFile.close();
-	
-}
-/* determines what state the cart is in and returns the required velocity*/
-float currStateV (int i, float h)
-{
-		if(gravityFree)
+			BenchStage stage(counters, "subdivideCurve");
+			subdivideCurve(control, settings.levels, &bake.curve);
+		}
+		n = bake.curve.size();
 		{
-			
-			v = velocity(h);
-			if (i >= startDec)
-			{
-				vdec = v;
-				decel = true;
-				gravityFree = false;
-			}
-			
-			
+			BenchStage stage(counters, "sections");
+			bake.pointSections = assignSections(bake.curve, tags, settings.levels);
+			bake.sections = findSections(bake.curve, bake.pointSections);
 		}
-		if(lifting)
 		{
-			v = 2.9;
-			if(i < startPoint && i > highestPointIndex)
-			{
-				lifting = false;
-				gravityFree = true;
-			}	
-		
+			BenchStage stage(counters, "designSpeeds");
+			bake.speeds = designSpeeds(bake.curve, bake.pointSections, bake.sections, settings);
 		}
-		
-		if(decel)
 		{
-			
-			currDist = distanceDecToStart(linePoints, startPoint, i);
-			v = vdec*(currDist/decDist);
-			if(i >= startPoint)
-			{
-				decel = false;
-				lifting = true;
-			} 
+			BenchStage stage(counters, "ArcLengthTable::build");
+			bake.arc.build(bake.curve);
 		}
-		
-	return v;
-}
-
-int main(int argc, char *argv[])
-{   
-    window = createGLFWWindow();
-    if(window == NULL)
-    	return -1;
-
+		{
+			BenchStage stage(counters, "bakeRails");
+			bake.frames.assign(n, mat3(1.0f));
+			bake.posRail.assign(n, vec3(0.0f));
+			bake.negRail.assign(n, vec3(0.0f));
+			bake.ties.assign(n + n%2, vec3(0.0f));
+			bakeRails(bake.curve, bake.speeds, settings.gravity, 0, n, &bake.frames, &bake.posRail, &bake.negRail, &bake.ties);
+		}
+		{
+			BenchStage stage(counters, "LapTable::build");
+			bake.lap.build(bake.curve, bake.frames, bake.speeds, bake.arc, settings.lapSpacing);
+		}
+		{
+			BenchStage stage(counters, "generateSupports");
+			generateSupports(bake.curve, settings.supportSpacing, settings.groundHeight, settings.supportWidth, &bake.supports);
+		}
+		{
+			BenchStage stage(counters, "bakeTrack");
+			TrackBake whole;
+			bakeTrack(control, tags, settings, &whole);
+		}
+	}
+
+	cout << "Baked " << trackFile << " to " << n << " points " << runs << " times, Frenet kernels: "
+		 << frenetKernelName(currentFrenetKernels()) << endl;
+	counters.printReport();
+	printAllocationReport();
+	return true;
+}
+
+/* summarises the replay's frame times, saves them and compares them with a baseline run*/
+void reportFrameTimes()
+{
+	FrameTimeSummary summary = summariseFrameTimes(frameTimes);
+	printFrameTimes(summary);
+	if(!frameTimesFile.empty())
+		writeFrameTimes(frameTimesFile, summary);
+	
+	FrameTimeSummary baseline;
+	if(!baselineFile.empty() && readFrameTimes(baselineFile, &baseline))
+		compareFrameTimes(baseline, summary);
+}
+
+int main(int argc, char *argv[])
+{   
+	TRACE_THREAD("main");
+	parseArguments(argc, argv);
+	if(assertNoAlloc && !allocationTracking())
+	{
+		cout << "--assert-no-alloc needs the allocation tracker, build with make ALLOCS=1" << endl;
+		return -1;
+	}
+	/* the headless runs exit here, with their trace written as the render loop's would be*/
+	if(benchRuns > 0 || !analyzeFile.empty())
+	{
+		bool ok = benchRuns > 0 ? benchBake(benchRuns) : analyzeTrack();
+		if(!traceFile.empty())
+			traceWrite(traceFile);
+		return ok ? 0 : -1;
+	}
+	if(!replayFile.empty() && !recording.load(replayFile))
+		return -1;
+	frameTimes.reserve(recording.size());
+	
+    window = createGLFWWindow();
+    if(window == NULL)
+    	return -1;
+
     //Initialize glad
     if (!gladLoadGL())
 	{
@@ -997,11 +1197,31 @@ int main(int argc, char *argv[])
 	initGL();
 
 	//Initialize shader
-	program = initShader("vertex.glsl", "fragment.glsl");
+	double shaderStart = glfwGetTime();
+	shaders.init((GLADloadproc)glfwGetProcAddress, "shadercache");
+	program = shaders.load("scene", "vertex.glsl", "fragment.glsl");
+	instancedProgram = shaders.load("instanced", "instanced_vertex.glsl", "fragment.glsl");
+	depthProgram = shaders.load("depth", "vertex.glsl", "depth_fragment.glsl");
+	depthInstancedProgram = shaders.load("depthInstanced", "instanced_vertex.glsl", "depth_fragment.glsl");
+	cartProgram = shaders.load("cart", "cart_vertex.glsl", "fragment.glsl");
+	cartDepthProgram = shaders.load("cartDepth", "cart_vertex.glsl", "depth_fragment.glsl");
+	if(gpuRails && !railGenerator.init(shaders, "rails_vertex.glsl"))
+		cout << "Building the rails on the CPU, rails_vertex.glsl did not build" << endl;
+	shaders.printStats();
+	materials.init();
+	attachMaterials();
+	
+	shadows.init(2048, 512);
+	shadows.setLight(lightDirection);
+	lapBuffer.init();
+	setupFrameGraph();
+	
+	int width, height;
+	glfwGetWindowSize(window, &width, &height);
+	frameGraph.screen(width, height);
+	cout << "Shader setup took " << (glfwGetTime() - shaderStart)*1000.0 << " ms" << endl;
 
 	
-	readFile();
-	
 	//GLuint vboLine; 
 
 	//Generate object ids
@@ -1033,52 +1253,54 @@ int main(int argc, char *argv[])
 	initVAO(vaoGround, vboGround);
 
 	
-	glGenVertexArrays(1, &vaoPillar);
-	glGenBuffers(VertexBuffers::COUNT, vboPillar.id);
-
-	glGenVertexArrays(1, &vaoPillarO);
-	glGenBuffers(VertexBuffers::COUNT, vboPillarO.id);
+	glGenVertexArrays(1, &vaoSupport);
+	glGenBuffers(VertexBuffers::COUNT, vboSupport.id);
+	glGenBuffers(1, &vboSupportInstances);
 	
-	initVAO(vaoPillarO, vboPillarO);
-	initVAO(vaoPillar, vboPillar);
+	initVAO(vaoSupport, vboSupport);
+	initInstanceVAO(vaoSupport, vboSupportInstances);
+	
+	/* room for every car's distance and the control polygon, with plenty to spare*/
+	stream.init(sizeof(float)*carCount + 64*1024);
 	
 	glGenVertexArrays(1, &vaoTrackCon);
 	glGenBuffers(VertexBuffers::COUNT, vboTrackCon.id);
 	initVAO(vaoTrackCon, vboTrackCon);
 	
-	generateWheel(&wheel, &wheelNorm, &wheelInd, 0.5f);
-	generateCube(&points, &normals, &indices, 0.5f);
-	generateSquare(&ground, &groundNorm, &groundInd, 0.5f);
+	glGenVertexArrays(1, &vaoControl);
+	glGenBuffers(VertexBuffers::COUNT, vboControl.id);
+	initVAO(vaoControl, vboControl);
 	
+	glGenVertexArrays(1, &vaoPreview);
+	glGenBuffers(VertexBuffers::COUNT, vboPreview.id);
+	initVAO(vaoPreview, vboPreview);
 	
-	/* setup buffers to draw line*/
-	generateLine(&linePoints, &lineNormal, &lineIndices);
+	generateWheel(&wheel, &wheelInd);
+	generateCube(&points, &normals, &indices, 0.5f);
+	generateSquare(&ground, &groundNorm, &groundInd, 0.5f);
 	
 	
 	generateSquareXYZCoords(&XYZPoints, &XYZNormals, &XYZIndices);
-	for(int i = 0; i < 10; i++)
-	{
-		linePoints = subdivision(linePoints, &lineIndices, &lineNormal);
-	}
-	
-	for(int i = 0; i < 10; i++)
-	{
-		wheel = subdivision(wheel, &wheelInd, &wheelNorm);
-	}
-	
-	H = highestPoint(linePoints);
-	low = lowestPoint(linePoints);
-	generatePillar(&pillar, &pillarNorm, &pillarInd, linePoints[highestPointIndex], linePoints[lowestPointIndex]);
-	generatePillar(&pillarO, &pillarONorm, &pillarOInd, linePoints[0], linePoints[lowestPointIndex]);
 	
+	/* the track and the wheel are subdivided on the job threads, the window draws meanwhile*/
+	startBake(trackFile);
+	startWheelBake();
 	
-	startPoint = zeroHeight(linePoints, low);
-	startDec = decelPoint(linePoints, low);
-	decDist = distanceDecToStart(linePoints, startPoint, startDec);
+	/* meshes that never change are loaded once*/
+	uploadMesh(vao, vbo, points, normals, indices);
+	uploadMesh(vaoGround, vboGround, ground, groundNorm, groundInd);
 	
+	/* supports share one unit column, with a model matrix per column*/
+	generateColumn(&column, &columnNorm, &columnInd);
+	uploadMesh(vaoSupport, vboSupport, column, columnNorm, columnInd);
 	
-
+	cout << "Frenet kernels: " << frenetKernelName(currentFrenetKernels()) << endl;
 	
+	/* saving any of these rebuilds it while the current one keeps drawing*/
+	watcher.watch(trackFile);
+	vector<string> shaderFiles = shaders.files();
+	for(int f = 0; f < (int)shaderFiles.size(); f++)
+		watcher.watch(shaderFiles[f]);
 	
 	Camera cam = Camera(vec3(0, 0, -1), vec3(-20, 20, 70));
 	activeCamera = &cam;
@@ -1086,75 +1308,179 @@ int main(int argc, char *argv[])
 	mat4 perspectiveMatrix = perspective(radians(80.f), 1.f, 0.1f, 300.f);
 
 	
-	int i;
+	int i = 0;
+	bool firstFrame = true, firstTrack = true;
+	size_t replayFrame = 0;
+	double lastSwap = 0;
 
-	i = startPoint;
-	createTrack(linePoints); //creates the positive and negative rails
-	v= 1.0f;
-	M = translate(mat4(1.0f), linePoints[i]);
-	animate(linePoints[i], i, linePoints, ds, v);
-
-	
-	MXYZ = translate(mat4(1.0f), linePoints[i]);
-	
+	/* wait for the display, unless replaying, where the frame times are the point*/
+	glfwSwapInterval(replayFile.empty() ? 1 : 0);
 
     // run an event-triggered main loop
     while (!glfwWindowShouldClose(window))
     {
+		checkForChanges();
+		if(uploads.run(0.004) > 0) //finished bake stages, a few ms of uploads a frame at most
+		{
+			sceneDirty = true;
+			quietFrames = 0;
+		}
+		if(trackChanged)
+		{
+			quietFrames = 0;
+			/* the new track may be shorter, start the lap again at its lift hill*/
+			trackChanged = false;
+			follow.reset();
+			cartFree = false;
+			brakeExcess = 0;
+			lapDistance = arcTable.s[startPoint];
+			LapPose pose = lapTable.sample(lapDistance);
+			i = pose.index;
+			placeCart(pose);
+			
+			if(firstTrack)
+			{
+				firstTrack = false;
+				cout << "Track ready after " << glfwGetTime()*1000.0 << " ms" << endl;
+				if(checkKernels)
+					checkFrenetKernels(linePoints, trackSpeeds, gravity, 1e-4f);
+			}
+		}
+		
+		/* paused with nothing changed, sleep until an event or the next look for changes*/
+		if(!frameOwed(glfwGetTime()))
+		{
+			glfwWaitEventsTimeout(idleWait);
+			prevT = glfwGetTime();
+			continue;
+		}
+		
+		TRACE_ZONE("frame");
+		frameAllocations.begin();
 		glClearColor(0.2, 0.2, 0.7, 1.0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);		//Clear color and depth buffers (Haven't covered yet)
 		
-		h = linePoints[i].y;
-		v = currStateV(i, h);
-	
-		
-		if(play)
-			{	
-				ds = v*dt;
-				animate(linePoints[i], i, linePoints, ds, v);		
-			}
+		/* variable timestep, clamped so a long stall does not teleport the cart*/
+		float now = glfwGetTime();
+		float frameDt = std::min(now - prevT, 0.1f)*simSpeed;
+		prevT = now;
 		
-	
-		V = cam.getMatrix();
+		/* a replay takes the view, play state and step of each frame from the recording,
+		 * so it draws the same frames however fast this build runs*/
+		if(trackReady && !replayFile.empty())
+		{
+			if(replayFrame == recording.size())
+				break;
+			const CameraSample& sample = recording[replayFrame++];
+			cam.place(sample.pos, sample.dir, sample.up);
+			play = sample.play;
+			frameDt = sample.dt;
+			cameraMode = CAMERA_ORBIT; //the recording holds the view whichever mode it was in
+		}
 		
-      
-		loadUniforms(program, winRatio*perspectiveMatrix*V, M);
-		render();
+		if(trackReady)
+		{
+			TRACE_ZONE("simulate");
+			v = cartSpeed(i);
 		
-        loadUniforms(program, winRatio*perspectiveMatrix*V, mWheelR);
-		renderLine(vaoWheel, vboWheel, wheel, wheelNorm, wheelInd);
-      
-		loadUniforms(program, winRatio*perspectiveMatrix*V, mWheelL);
-		renderLine(vaoWheel, vboWheel, wheel, wheelNorm, wheelInd);
+			if(play)
+				{	
+					/* the free section is integrated along the arc length instead of read off the table*/
+					if(cartFree)
+					{
+						int steps = integrate(arcTable, integrator, &cart, frameDt);
+						keepMoving(&cart, minCrawlSpeed);
+						energyReport.update(arcTable, integrator, cart, steps);
+						v = cart.v;
+						lapDistance = cart.s;
+					}
+					else
+						lapDistance = arcTable.wrapDistance(lapDistance + v*frameDt);
+					
+					LapPose pose = lapTable.sample(lapDistance);
+					i = pose.index;
+					placeCart(pose);
+				}
+		}
 		
-		loadUniforms(program, winRatio*perspectiveMatrix*V, scale(mat4(1.0f), vec3(25.0f, 3.0f, 30.0f)));
-		renderGround(vaoGround, vboGround, ground, groundNorm, groundInd);
 	
-		loadUniforms(program, winRatio*perspectiveMatrix*V, mat4(1.0f));
-		renderPillar(vaoPillar, vboPillar, pillar, pillarNorm, pillarInd);
+		/* the ride and chase views follow the cart, the trackball stays with the mouse*/
+		Camera* view = &cam;
+		if(cameraMode != CAMERA_ORBIT && trackReady)
+		{
+			follow.update(cameraMode, linePoints, trackFrames, i, vec3(MXYZ[3]), frameDt/simSpeed, &followView);
+			view = &followView;
+		}
+		
+		if(trackReady && !recordFile.empty() && replayFile.empty())
+		{
+			CameraSample sample;
+			sample.dir = view->getDirection();
+			sample.right = view->getRight();
+			sample.up = view->getUp();
+			sample.pos = view->getPosition();
+			sample.play = play;
+			sample.dt = frameDt;
+			recording.add(sample);
+		}
 	
-		loadUniforms(program, winRatio*perspectiveMatrix*V, mat4(1.0f));
-		renderPillar(vaoPillarO, vboPillarO, pillarO, pillarONorm, pillarOInd);
+		view->setProjection(winRatio*perspectiveMatrix);
+		V = view->getMatrix();
+		stream.beginFrame();
+		if(trackReady)
+			spaceCars();
+		prepareLighting(view->getPosition());
+		if(trackReady)
+			prepareCars();
+		submitScene();
+		frameGraph.execute(view->getViewProjection());
+		stream.endFrame();
+		glState.endFrame();
 	
+        // scene is rendered to the back buffer, so swap to front for display
+		{
+			TRACE_ZONE("swap");
+			glfwSwapBuffers(window);
+		}
 		
-		loadUniforms(program, winRatio*perspectiveMatrix*V, mat4(1.0f));
-		renderLine(vaoNeg, vboNeg, negRail, negNorm, negIndices); 
-		
-		
-		
-		loadUniforms(program, winRatio*perspectiveMatrix*V, mat4(1.0f));
-		renderLine(vaoPos, vboPos, posRail, posNorm, posIndices);
+		double swapped = glfwGetTime();
+		if(replayFrame > 1)
+			frameTimes.push_back(float((swapped - lastSwap)*1000.0));
+		lastSwap = swapped;
 		
-		loadUniforms(program, winRatio*perspectiveMatrix*V, mat4(1.0f));
-		renderLine(vaoTrackCon, vboTrackCon, trackConnect, trackConnectNorm, trackConnectInd);
-	
-        // scene is rendered to the back buffer, so swap to front for display
-        glfwSwapInterval(1);
-        glfwSwapBuffers(window);
+		/* a recording grows as it goes, so only frames that aren't recorded are held to nothing*/
+		frameAllocations.end(trackReady && quietFrames >= warmupFrames && recordFile.empty());
+		quietFrames++;
+		if(firstFrame)
+		{
+			firstFrame = false;
+			cout << "First frame after " << glfwGetTime()*1000.0 << " ms" << endl;
+		}
         
 		glfwPollEvents();
 	}
 
+	frameGraph.printStats();
+	glState.printStats();
+	stream.printStats();
+	if(!recordFile.empty())
+		recording.save(recordFile);
+	if(!replayFile.empty())
+		reportFrameTimes();
+	if(!traceFile.empty())
+		traceWrite(traceFile);
+	
+	int status = 0;
+	if(allocationTracking())
+	{
+		frameAllocations.print();
+		printAllocationReport();
+	}
+	if(assertNoAlloc && frameAllocations.steadyFramesThatAllocated() > 0)
+	{
+		cout << "ERROR: the render loop allocated after warming up" << endl;
+		status = 1;
+	}
 	deleteStuff();
 	
 
@@ -1162,7 +1488,7 @@ int main(int argc, char *argv[])
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
-   return 0;
+   return status;
 }
 
 
@@ -1179,337 +1505,435 @@ int wrap(int i)
 }
 // ==========================================================================
 // SUPPORT FUNCTION DEFINITIONS
-/* Bt = bead, i = current point the bead is on, points is the curve, Ds the user input distance to travel
- * 
- * Returns the point at which the object should be at on the curve based on the passed in Ds
- * */
 
-/* returns the next position the cart should be on the curve*/
-vec3 posOnCurve(vec3 Bt, int &i, vector<vec3> points, float ds)
-{
-	return archLength(Bt, i, points, ds);
-}
-/*temporary tangent used to calculate the normal*/
-vec3 tangentTemp(vec3 nextPos, vec3 prevPos)
+/* sets the lead cart's matrices from its pose on the lap, for the cameras and the shadow
+ * map that follow it. The GPU places every car it draws from the same table*/
+void placeCart(const LapPose& pose)
 {
-	vec3 T = nextPos - prevPos;
-	T = T / getLength(T);
-	return T;
+	MXYZ = mat4(pose.frame);
+	MXYZ[3] = vec4(pose.position, 1.0f);
+	
+	M = mat4(pose.frame*0.75f);
+	M[3] = vec4(pose.position + vec3(0.0f, 1.0f, 0.0f), 1.0f);
 }
-/*Tangent of the frenet frame from, the binormal B, and normal N*/
-vec3 tangent(vec3 B, vec3 N)
+
+/* B-Spline subdivision of control points to create a curve*/
+vector<vec3> subdivision(vector<vec3> points, vector<unsigned int>* indices, vector<vec3>* normals)
 {
-	vec3 T = cross(N,B);
-	T = T / getLength(T);
-	return T;
+	/* split and average, shared with the track bake*/
+	vector<vec3> averagedPoints = subdivideCurve(points);
+	indices->clear();
+	normals->clear();
 	
+	int nextEl;
+	for(int i = 0;  i < averagedPoints.size(); i++)
+	{
+		indices->push_back(i);
+		
+		nextEl = i + 1;
+		if(nextEl != averagedPoints.size())
+			indices->push_back(i+1);
+		else
+			indices->push_back(0);
+	
+		normals->push_back(vec3(0.0f,0.0,0.0));
+	}
+	
+	return averagedPoints;
 }
-/* The normal of the frenet Frame given the centripetal acceleration direction centDirection, gravity, velocity, and curvature r (or 1/k) */
-vec3 normal(vec3 centDirection, vec3 gravity, float v, float r)
+/* rails and ties for count points of the curve from first on, which may wrap past the end*/
+void computeRails(const vector<vec3>& points, int first, int count)
 {
-	vec3 N = (((v*v)/r) * centDirection) + gravity;
-	N = N / getLength(N);
-	return N;
+	bakeRails(points, trackSpeeds, gravity, first, count, &trackFrames, &posRail, &negRail, &trackConnect);
 }
-/* used for figuring out the curvature of the curve in order to determine how much the cart tilts*/
-float curvature (vec3 nextPos, vec3 currPos, vec3 prevPos)
+/*
+ Creates the index and colour arrays of both rails and the ties for a curve of n points
+  */
+void createTrack(int n)
 {
-	vec3 nVec = (nextPos - (2.0f * currPos) + prevPos);
-	float x = 0.5f * getLength(nVec);
-	float c = 0.5f * getLength((nextPos - prevPos));
-
-	float k = 1.0f / ((x*x)+(c*c));
-
-
-	return k;
+	negIndices.clear();
+	posIndices.clear();
+	trackConnectInd.clear();
+	
+	int nextEl;
+	for(int j = 0; j < n; j++)
+	{
+		if(j%2 == 0)
+		{
+			trackConnectInd.push_back(j);
+			trackConnectInd.push_back(j+1);
+		}
+		negIndices.push_back(j);
+		posIndices.push_back(j);
+		
+		nextEl = j + 1;
+		if(nextEl < n)
+		{
+			negIndices.push_back(j+1);
+			posIndices.push_back(j+1);
+		}
+		else
+		{
+			negIndices.push_back(0);
+			posIndices.push_back(0);
+		}
+	}
 }
 
-/*direction of the centripetal force*/
-vec3 centDir (vec3 nextPos, vec3 currPos, vec3 prevPos)
+/* loads the supports' model matrices, their count changes with the track's length*/
+void uploadSupports()
 {
-	vec3 nVec = (nextPos - (2.0f * currPos) + prevPos);
-	nVec = nVec / getLength(nVec);
-	return nVec;
+	glState.bindBuffer(GL_ARRAY_BUFFER, vboSupportInstances);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(mat4)*supportInstances.size(), supportInstances.empty() ? 0 : &supportInstances[0], GL_STATIC_DRAW);
 }
-/*gets the length of a vector*/
-float getLength(vec3 v)
+
+/* loads the lap table for the cars. A track too long for a texture buffer at the set spacing
+ * gets this one table built coarser, just fine enough to fit. The cars aren't drawn if even
+ * that doesn't*/
+void uploadLap()
 {
-	return sqrt((v.x * v.x) + (v.y * v.y) + (v.z * v.z));
+	int limit = lapBuffer.maxSamples();
+	if((int)lapTable.position.size() > limit && limit > 2)
+	{
+		float spacing = arcTable.total/(limit - 1);
+		cout << "Lap table spacing raised to " << spacing << " to fit a texture buffer" << endl;
+		lapTable.build(linePoints, trackFrames, trackSpeeds, arcTable, spacing);
+	}
+	lapUploaded = lapBuffer.upload(lapTable);
 }
 
-/* Calculate the binormal of the curve*/
-vec3 binormal(vec3 normal, vec3 tangent)
+/* swaps a finished bake in as the current track and loads its buffers. The old track's
+ * arrays end up in bake, which the callers keep as spareBake for the next bake to fill*/
+void applyBake(TrackBake* bake)
 {
-	vec3 B = cross(normal, tangent);
-	B = B / getLength(B);
-	return B;
+	TRACE_ZONE("applyBake");
+	AllocationStage allocations("applyBake");
+	controlPoints.swap(bake->control);
+	controlTags.swap(bake->tags);
+	linePoints.swap(bake->curve);
+	trackSections.swap(bake->pointSections);
+	trackSpeeds.swap(bake->speeds);
+	trackFrames.swap(bake->frames);
+	std::swap(arcTable, bake->arc);
+	std::swap(lapTable, bake->lap);
+	uploadLap();
+	posRail.swap(bake->posRail);
+	negRail.swap(bake->negRail);
+	trackConnect.swap(bake->ties);
+	supportInstances.swap(bake->supports);
+	
+	startPoint = bake->sections.startPoint;
+	
+	createTrack(linePoints.size());
+	if(railGenerator.ready())
+	{
+		uploadIndices(vaoPos, vboPos, posIndices);
+		uploadIndices(vaoNeg, vboNeg, negIndices);
+		uploadIndices(vaoTrackCon, vboTrackCon, trackConnectInd);
+		railGenerator.build(linePoints, trackFrames, vboPos.id[VertexBuffers::VERTICES],
+							vboNeg.id[VertexBuffers::VERTICES], vboTrackCon.id[VertexBuffers::VERTICES]);
+	}
+	else
+	{
+		uploadMesh(vaoPos, vboPos, posRail, noNormals, posIndices);
+		uploadMesh(vaoNeg, vboNeg, negRail, noNormals, negIndices);
+		uploadMesh(vaoTrackCon, vboTrackCon, trackConnect, noNormals, trackConnectInd);
+	}
+	uploadSupports();
 	
+	selectedControl = std::min(selectedControl, (int)controlPoints.size() - 1);
+	uploadControlPolygon();
+	fitStaticShadow();
 }
 
-
-/* Moves the cart along the track */
-void animate(vec3 cartLoc, int &i, vector<vec3> points, float ds, float v)
+/* bakes the whole track again from the control points, on this thread. Any bake still
+ * running on the job threads is older than the edits, so its stages are dropped*/
+void rebuildTrack()
 {
-	
-	
-	vec3 nextPos = posOnCurve(cartLoc, i, points, ds);
-	vec3 prevPos = points[wrap(i-1)];
-	vec3 nextPosOnCurve = points[wrap(i+1)];
-	
-	vec3 centDirection = centDir(nextPosOnCurve, cartLoc, prevPos);
-	float k = curvature(nextPosOnCurve, cartLoc, prevPos);
-	float r = 1.0f / k;
-
+	TRACE_ZONE("rebuildTrack");
+	AllocationStage allocations("rebuildTrack");
+	std::shared_ptr<TrackBake> bake = takeSpareBake();
+	bakeGeneration++;
+	bakeSettings.gravity = gravity;
+	if(bakeTrack(controlPoints, controlTags, bakeSettings, bake.get()))
+		applyBake(bake.get());
+	spareBake = bake;
+}
 
-	vec3 N = normal(centDirection, gravity, v, r);
-	
-	vec3 tempT = tangentTemp(nextPosOnCurve, prevPos);
+/* a bake to fill, holding the arrays of the track before last if there is one*/
+std::shared_ptr<TrackBake> takeSpareBake()
+{
+	std::shared_ptr<TrackBake> bake = spareBake ? spareBake : std::make_shared<TrackBake>();
+	spareBake.reset();
+	return bake;
+}
 
+/* queues a finished bake to be swapped in on the GL thread, unless a newer bake or an edit
+ * came after it*/
+void postBake(int generation, const std::shared_ptr<TrackBake>& bake)
+{
+	uploads.post([=]{
+		if(generation != bakeGeneration)
+			return;
+		applyBake(bake.get());
+		spareBake = bake;
+		trackReady = true;
+		trackChanged = true;
+	});
+}
 
-	vec3 B = binormal(N, tempT);
-	
-	
-	vec3 T = tangent(B, N);
-	
-	mat4 modelTrans = translate(mat4(1.0f), nextPos);
-	
-	
-	mat4 frenetFrame = freFrame(N, B, T);
+/* copies what a stage of the first bake added and queues it for the GL thread, runs on a
+ * job thread. The first track streams in as it is built, the bake goes on filling its arrays*/
+void postBakeStage(int generation, BakeStage stage, const TrackBake& partial)
+{
+	if(generation != bakeGeneration)
+		return;
 	
-	vec3 Btemp = B;
+	if(stage == BAKE_CONTROL || stage == BAKE_LEVEL)
+	{
+		std::shared_ptr<vector<vec3> > curve = std::make_shared<vector<vec3> >(partial.curve);
+		uploads.post([=]{
+			if(generation == bakeGeneration && !trackReady)
+				uploadPreview(*curve);
+		});
+	}
+	else if(stage == BAKE_RAILS)
+		postBake(generation, std::make_shared<TrackBake>(partial));
+	else if(stage == BAKE_SUPPORTS)
+	{
+		std::shared_ptr<vector<mat4> > supports = std::make_shared<vector<mat4> >(partial.supports);
+		uploads.post([=]{
+			if(generation != bakeGeneration)
+				return;
+			supportInstances.swap(*supports);
+			uploadSupports();
+			fitStaticShadow();
+		});
+	}
+}
 
-	Btemp *= 0.5f;
-	vec3 wheelTemp = cartLoc + Btemp;
-	
-	
-	
-	mat4 wheelRTrans = translate(mat4(1.0f), wheelTemp);
-	
-	Btemp = B;
-	Btemp *= 2.5f;
-	wheelTemp = cartLoc - Btemp;
-	mat4 wheelLTrans = translate(mat4(1.0f), wheelTemp);
-	
-	M = translate(mat4(1.0f), vec3(0.0f,1.0f,0.0f)) * modelTrans * frenetFrame * scale(mat4(1.0f), vec3(0.75f, 0.75f, 0.75f));
-	MXYZ = modelTrans * frenetFrame;
-	freeFrame = frenetFrame;
-	
-	
-	mWheelL = wheelLTrans * frenetFrame;
-	mWheelR = wheelRTrans * frenetFrame;
-	
+/* reads and bakes a track file on the job threads*/
+void startBake(const string& filename)
+{
+	int generation = ++bakeGeneration;
+	bool firstBake = !trackReady;
+	BakeSettings settings = bakeSettings;
+	settings.gravity = gravity;
+	
+	std::shared_ptr<TrackBake> bake = takeSpareBake();
+	
+	/* the first track is streamed in stage by stage, a reload is handed over whole at the end*/
+	jobs.submit([=]{
+		AllocationStage allocations("track bake");
+		vector<vec3> control;
+		vector<SectionType> tags;
+		BakeProgress progress;
+		if(firstBake)
+			progress = [=](BakeStage stage, const TrackBake& partial){
+				postBakeStage(generation, stage, partial);
+			};
+		
+		if(!readTrackFile(filename, &control, &tags) || !bakeTrack(control, tags, settings, bake.get(), progress))
+			cout << "Keeping the current track, " << filename << " did not bake" << endl;
+		else if(!firstBake)
+			postBake(generation, bake);
+	});
+}
 
+/* subdivides the wheel on the job threads, it is only drawn once the track is ready*/
+void startWheelBake()
+{
+	vector<vec3> coarse = wheel;
+	wheelInd.clear(); //nothing to draw until the fine wheel is loaded
+	jobs.submit([=]{
+		std::shared_ptr<vector<vec3> > fine = std::make_shared<vector<vec3> >();
+		subdivideCurve(coarse, 10, fine.get());
+		
+		uploads.post([=]{
+			wheel.swap(*fine);
+			closedLoopIndices(wheel.size(), &wheelInd);
+			uploadMesh(vaoWheel, vboWheel, wheel, noNormals, wheelInd);
+		});
+	});
 }
 
+/* whether this pass of the loop draws. A running cart, a replay or a recording draws every
+ * frame, otherwise only until settleTime after the last change*/
+bool frameOwed(double now)
+{
+	if(continuous || (play && trackReady) || !replayFile.empty() || !recordFile.empty())
+		return true;
+	if(sceneDirty)
+	{
+		sceneDirty = false;
+		lastChange = now;
+	}
+	return now - lastChange < settleTime;
+}
 
-/*
-							B.x,N.x,T.x,0.0
-							B.y,N.y,T.y,0.0
-							B.z,N.z,T.z,0.0
-							0.0,0.0,0.0,1.0);
-
-Sets up the frenet frame with the Normal N, binormal B, tangent T
-*/
-mat4 freFrame(vec3 N, vec3 B, vec3 T)
+/* starts a background bake when the track file changes and rebuilds the programs whose
+ * sources changed. Shaders are swapped between frames, a failed build leaves the old one in use*/
+void checkForChanges()
 {
-	mat4 frenetFrame;
-	
-	frenetFrame[0][0] = B.x; 
-	frenetFrame[0][1] = B.y; 
-	frenetFrame[0][2] = B.z;
-	
-	frenetFrame[1][0] = N.x; 
-	frenetFrame[1][1] = N.y; 
-	frenetFrame[1][2] = N.z;
-	
-	frenetFrame[2][0] = T.x; 
-	frenetFrame[2][1] = T.y; 
-	frenetFrame[2][2] = T.z;
-	
-	
-	
-	return frenetFrame;
+	TRACE_ZONE("checkForChanges");
+	vector<string> changed = watcher.changed();
+	for(int c = 0; c < (int)changed.size(); c++)
+	{
+		if(changed[c] == trackFile)
+			startBake(trackFile);
+		else if(shaders.reload(changed[c]))
+		{
+			sceneDirty = true;
+			program = shaders.get("scene");
+			instancedProgram = shaders.get("instanced");
+			depthProgram = shaders.get("depth");
+			depthInstancedProgram = shaders.get("depthInstanced");
+			cartProgram = shaders.get("cart");
+			cartDepthProgram = shaders.get("cartDepth");
+			attachMaterials();
+			frameGraph.programsChanged();
+			
+			/* the rails are made by their program, so a new one makes them again*/
+			railGenerator.programChanged(shaders);
+			if(railGenerator.ready() && trackReady)
+				railGenerator.build(linePoints, trackFrames, vboPos.id[VertexBuffers::VERTICES],
+									vboNeg.id[VertexBuffers::VERTICES], vboTrackCon.id[VertexBuffers::VERTICES]);
+		}
+	}
 }
-/*-----------------------------------------------------------------------------------------------------------------*/
 
-/* Gives the next location along the curve witha  given starting location Bt, current location on the curve i, curve points points, and distance to travel ds */
-vec3 archLength(vec3 Bt, int &i, vector<vec3> points, float Ds)
+/* widens the run of count points from first to cover every point whose design speed changed,
+ * leaving out the longest run of unchanged points so it stays as short as it can*/
+void widenToSpeedChanges(const vector<float>& before, const vector<float>& after, int* first, int* count)
 {
+	int n = after.size();
+	if((int)before.size() != n || *count >= n)
+	{
+		*first = 0;
+		*count = n;
+		return;
+	}
 	
-	vec3 objPos = points[wrap(i+1)] - Bt;
-	float lenToNextPoint = getLength(objPos);
-	float DsP;
-	vec3 currLine;
-	
-	/* moves to the next point on the curve  even if Ds = 0 or the distance to move is less than the distance to the next point*/
-	if(lenToNextPoint > Ds)
+	/* walks the points outside the run, starting just past its end*/
+	int start = (*first + *count) % n;
+	int gapFirst = 0, gapLength = 0, runFirst = 0, runLength = 0;
+	for(int k = 0; k < n - *count; k++)
+	{
+		int i = (start + k) % n;
+		if(before[i] != after[i])
 		{
-			i++;
-			i = wrap(i);
-			return (Bt + (Ds *(objPos/lenToNextPoint)));
+			runLength = 0;
+			continue;
 		}
-	else
+		if(runLength == 0)
+			runFirst = i;
+		if(++runLength > gapLength)
 		{
-			DsP = lenToNextPoint;
-			i++;
-			i = wrap(i);
-			
+			gapFirst = runFirst;
+			gapLength = runLength;
 		}
-			currLine = points[wrap(i+1)] - points[wrap(i)];
-			/* based on the total distance(Ds) to travel it calculates the next point that the object should be at*/
-			while((DsP + getLength(currLine)) < Ds)
-			{
-				DsP = DsP + getLength(currLine);
-				
-				currLine = points[wrap(i+1)] - points[wrap(i)];
-				i++;
-				i = wrap(i);
-				
-			}
-			
-		
-		return ((Ds - DsP)*(currLine / getLength(currLine))) + points[wrap(i)];
-		
-
+	}
+	
+	*first = (gapFirst + gapLength) % n;
+	*count = n - gapLength;
 }
-/* B-Spline subdivision of control points to create a curve*/
-vector<vec3> subdivision(vector<vec3> points, vector<unsigned int>* indices, vector<vec3>* normals)
+
+/* moves one control point and rebuilds only the stretch of curve, rails and ties it reaches*/
+void moveControlPoint(int index, vec3 offset)
 {
-	vector<vec3> splitPoints;
-	vector<vec3> averagedPoints;
-	vec3 midPoint;
-	indices->clear();
-	normals->clear();
+	TRACE_ZONE("moveControlPoint");
+	AllocationStage allocations("moveControlPoint");
+	bakeGeneration++; //a bake still running on the job threads predates this edit
+	controlPoints[index] += offset;
 	
-	int nextEl;
-	/* Splitting*/
-	for(int i = 0; i < points.size(); i++)
+	int first, count;
+	if(!resubdivideSpan(controlPoints, bakeSettings.levels, index, &linePoints, &first, &count))
 	{
-		splitPoints.push_back(points[i]);
-		nextEl = i + 1;
-		if(nextEl != points.size())
-			midPoint = 0.5f*(points[i] + points[nextEl]);
-		else
-			midPoint = 0.5f*(points[i] + points[0]);
-		
-		splitPoints.push_back(midPoint);
+		rebuildTrack();
+		return;
 	}
 	
-	/* Averaging */
-	for(int j = 0; j < splitPoints.size(); j++)
+	/* the frames either side of the run have moved points as neighbours*/
+	first = wrap(first - 1);
+	count = std::min(count + 2, (int)linePoints.size());
+	
+	/* the speeds hang on the heights of the whole lap, but are one cheap pass over it. The rails
+	 * bank for them, so every point whose speed changed gets new frames too*/
+	bakeSettings.gravity = gravity;
+	trackSections = assignSections(linePoints, controlTags, bakeSettings.levels);
+	TrackSections sections = findSections(linePoints, trackSections);
+	vector<float> speeds = designSpeeds(linePoints, trackSections, sections, bakeSettings);
+	widenToSpeedChanges(trackSpeeds, speeds, &first, &count);
+	trackSpeeds.swap(speeds);
+	startPoint = sections.startPoint;
+	
+	computeRails(linePoints, first, count);
+	arcTable.update(linePoints, first, count);
+	lapTable.build(linePoints, trackFrames, trackSpeeds, arcTable, bakeSettings.lapSpacing);
+	uploadLap();
+	
+	if(railGenerator.ready())
+		railGenerator.update(linePoints, trackFrames, first, count, vboPos.id[VertexBuffers::VERTICES],
+							vboNeg.id[VertexBuffers::VERTICES], vboTrackCon.id[VertexBuffers::VERTICES]);
+	else
 	{
-		nextEl = j+1;
-		if(nextEl != splitPoints.size())
-			midPoint = 0.5f*(splitPoints[j] + splitPoints[nextEl]);
-		else
-			midPoint = 0.5f*(splitPoints[j] + splitPoints[0]);
-		
-		averagedPoints.push_back(midPoint);
-		
-			
-		
-		
-	
+		updateBufferRange(vboPos.id[VertexBuffers::VERTICES], posRail, first, count);
+		updateBufferRange(vboNeg.id[VertexBuffers::VERTICES], negRail, first, count);
+		updateBufferRange(vboTrackCon.id[VertexBuffers::VERTICES], trackConnect, first - first%2, count + 2);
 	}
 	
-	for(int i = 0;  i < averagedPoints.size(); i++)
+	/* supports are spaced by arc length, so they all shift along and are cheap to redo*/
+	generateSupports(linePoints, bakeSettings.supportSpacing, bakeSettings.groundHeight, bakeSettings.supportWidth, &supportInstances);
+	uploadSupports();
+	uploadControlPolygon();
+	fitStaticShadow();
+}
+
+/* line indices joining n points into a closed loop*/
+void closedLoopIndices(int n, vector<unsigned int>* loop)
+{
+	loop->clear();
+	for(int i = 0; i < n; i++)
 	{
-		indices->push_back(i);
-		
-		nextEl = i + 1;
-		if(nextEl != averagedPoints.size())
-			indices->push_back(i+1);
-		else
-			indices->push_back(0);
-	
-		normals->push_back(vec3(0.0f,0.0,0.0));
+		loop->push_back(i);
+		loop->push_back((i + 1) % n);
 	}
-	
-	return averagedPoints;
 }
-/*
-Orients the track to curve when the cart should curve 
-*/
-vec3 trackAnimation(vec3 cartLoc, int i, vector<vec3> points, float ds, float v)
-{
-	
-	vec3 nextPos = posOnCurve(cartLoc, i, points, ds);
-	vec3 prevPos = points[wrap(i-1)];
-	vec3 nextPosOnCurve = points[wrap(i+1)];
-	
 
+/* loads the control polygon as a loop of lines, the selected point is drawn over it*/
+void uploadControlPolygon()
+{
+	int n = controlPoints.size();
+	closedLoopIndices(n, &controlInd);
 	
-	vec3 centDirection = centDir(nextPosOnCurve, cartLoc, prevPos);
-	float k = curvature(nextPosOnCurve, cartLoc, prevPos);
-	float r = 1.0f / k;
-
-	vec3 N = normal(centDirection, gravity, v, r);
-	
-	vec3 tempT = tangentTemp(nextPosOnCurve, prevPos);
-
-
-	vec3 B = binormal(N, tempT);
-	
-	
+	uploadIndices(vaoControl, vboControl, controlInd);
+}
 
-	return B*1.5f;
+/* loads a coarse stage of the curve, shown until the first track is ready*/
+void uploadPreview(const vector<vec3>& curve)
+{
+	TRACE_ZONE("uploadPreview");
+	closedLoopIndices(curve.size(), &previewInd);
+	uploadMesh(vaoPreview, vboPreview, curve, noNormals, previewInd);
 }
-/* find the binormal at each point and add it to the current track for one rail and subtract it from the current track for the other rail*/
-/*
- Creates all the points for the track and stores it in 3 arrays
-  */
-void createTrack (vector<vec3> points)
+
+/* writes the control points back to the track file*/
+void saveTrack()
 {
-	
-	
-	int nextEl;
-	vec3 binormal;
-	vec3 cartLoc;
-	float ds;
-	float v;
-	for(int j = 0; j < points.size(); j++)
+	ofstream myFile(trackFile.c_str());
+	for(int i = 0; i < (int)controlPoints.size(); i++)
 	{
-	
-		v = currStateV(j, points[j].y);
-	
-		ds = v*dt;
-		binormal = trackAnimation(points[j], j, points, ds, v);
-	
-		negRail.push_back((points[j] - binormal));
-		posRail.push_back((points[j] + binormal));
-		
-		
-		if(j%2 == 0)
-		{
-			trackConnect.push_back((points[j] - binormal));
-			trackConnect.push_back((points[j] + binormal));
-			trackConnectInd.push_back(j);
-			trackConnectInd.push_back(j+1);
-			trackConnectNorm.push_back(vec3(0.5f, 0.5f, 0.0f));
-			trackConnectNorm.push_back(vec3(0.5f, 0.5f, 0.0f));
-		}
-		negIndices.push_back(j);
-		posIndices.push_back(j);
-		
-		posNorm.push_back(vec3(0.8f, 0.4f, 0.0f));
-		negNorm.push_back(vec3(0.8f, 0.4f, 0.0f));
-		
-		nextEl = j + 1;
-		if(nextEl < points.size())
-		{
-			
-			negIndices.push_back(j+1);
-			posIndices.push_back(j+1);
-		}
-		else
-		{
-		
-			negIndices.push_back(0);
-			posIndices.push_back(0);
-		}
-		
+		myFile << controlPoints[i].x << " " << controlPoints[i].y << " " << controlPoints[i].z;
+		if(i < (int)controlTags.size() && controlTags[i] != SECTION_UNTAGGED)
+			myFile << " " << sectionName(controlTags[i]);
+		myFile << endl;
 	}
+	myFile.close();
+	
+	/* the file now holds the track as it is, baking it again would only undo later edits*/
+	watcher.ignore(trackFile);
 	
+	cout << "Saved " << controlPoints.size() << " control points to " << trackFile << endl;
 }
 
 // --------------------------------------------------------------------------
@@ -1527,7 +1951,7 @@ void QueryGLVersion()
          << "on renderer [ " << renderer << " ]" << endl;
 }
 
-bool CheckGLErrors(string location)
+bool CheckGLErrors(const char* location)
 {
     bool error = false;
     for (GLenum flag = glGetError(); flag != GL_NO_ERROR; flag = glGetError())
@@ -1552,85 +1976,4 @@ bool CheckGLErrors(string location)
     return error;
 }
 
-// --------------------------------------------------------------------------
-// OpenGL shader support functions
-
-// reads a text file with the given name into a string
-string LoadSource(const string &filename)
-{
-    string source;
-
-    ifstream input(filename.c_str());
-    if (input) {
-        copy(istreambuf_iterator<char>(input),
-             istreambuf_iterator<char>(),
-             back_inserter(source));
-        input.close();
-    }
-    else {
-        cout << "ERROR: Could not load shader source from file "
-             << filename << endl;
-    }
-
-    return source;
-}
-
-// creates and returns a shader object compiled from the given source
-GLuint CompileShader(GLenum shaderType, const string &source)
-{
-    // allocate shader object name
-    GLuint shaderObject = glCreateShader(shaderType);
-
-    // try compiling the source as a shader of the given type
-    const GLchar *source_ptr = source.c_str();
-    glShaderSource(shaderObject, 1, &source_ptr, 0);
-    glCompileShader(shaderObject);
-
-    // retrieve compile status
-    GLint status;
-    glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        GLint length;
-        glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &length);
-        string info(length, ' ');
-        glGetShaderInfoLog(shaderObject, info.length(), &length, &info[0]);
-        cout << "ERROR compiling shader:" << endl << endl;
-        cout << source << endl;
-        cout << info << endl;
-    }
-
-    return shaderObject;
-}
-
-// creates and returns a program object linked from vertex and fragment shaders
-GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader)
-{
-    // allocate program object name
-    GLuint programObject = glCreateProgram();
-
-    // attach provided shader objects to this program
-    if (vertexShader)   glAttachShader(programObject, vertexShader);
-    if (fragmentShader) glAttachShader(programObject, fragmentShader);
-
-    // try linking the program with given attachments
-    glLinkProgram(programObject);
-
-    // retrieve link status
-    GLint status;
-    glGetProgramiv(programObject, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        GLint length;
-        glGetProgramiv(programObject, GL_INFO_LOG_LENGTH, &length);
-        string info(length, ' ');
-        glGetProgramInfoLog(programObject, info.length(), &length, &info[0]);
-        cout << "ERROR linking shader program:" << endl;
-        cout << info << endl;
-    }
-
-    return programObject;
-}
-
-
 // ==========================================================================
@@ -0,0 +1,54 @@
+#include "materials.h"
+#include "glstate.h"
+
+static Material lit(vec3 colour, float ambient, float specular, float shininess)
+{
+	Material m;
+	m.colour = vec4(colour, 1.0f);
+	m.surface = vec4(ambient, specular, shininess, 1.0f);
+	return m;
+}
+
+/* lines have no surface to light, they keep their colour*/
+static Material unlit(vec3 colour)
+{
+	Material m;
+	m.colour = vec4(colour, 1.0f);
+	m.surface = vec4(1.0f, 0.0f, 1.0f, 0.0f);
+	return m;
+}
+
+void MaterialTable::init()
+{
+	Material table[maxMaterials];
+	table[MATERIAL_CART] = lit(vec3(0.8f, 0.05f, 0.05f), 0.3f, 0.6f, 32.0f);
+	table[MATERIAL_GROUND] = lit(vec3(0.15f, 0.45f, 0.15f), 0.35f, 0.0f, 1.0f);
+	table[MATERIAL_SUPPORT] = lit(vec3(0.55f, 0.55f, 0.5f), 0.3f, 0.2f, 16.0f);
+	table[MATERIAL_RAIL] = unlit(vec3(0.8f, 0.4f, 0.0f));
+	table[MATERIAL_TIE] = unlit(vec3(0.5f, 0.5f, 0.0f));
+	table[MATERIAL_WHEEL] = unlit(vec3(1.0f, 1.0f, 1.0f));
+	table[MATERIAL_CONTROL] = unlit(vec3(1.0f, 0.8f, 0.0f));
+	table[MATERIAL_SELECTED] = unlit(vec3(1.0f, 1.0f, 1.0f));
+	table[MATERIAL_PREVIEW] = unlit(vec3(1.0f, 0.8f, 0.0f));
+	for(int m = MATERIAL_COUNT; m < maxMaterials; m++)
+		table[m] = unlit(vec3(1.0f, 0.0f, 1.0f));
+
+	glGenBuffers(1, &buffer);
+	glState.bindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(table), table, GL_STATIC_DRAW);
+	glState.bindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+void MaterialTable::attach(GLuint program) const
+{
+	GLuint block = glGetUniformBlockIndex(program, "Materials");
+	if(block != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, block, binding);
+}
+
+void MaterialTable::release()
+{
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
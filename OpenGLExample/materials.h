@@ -0,0 +1,47 @@
+#ifndef MATERIALS_H
+#define MATERIALS_H
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+using namespace glm;
+
+/* Every surface in the scene, a draw picks one by index */
+enum MaterialIndex{
+	MATERIAL_CART = 0,
+	MATERIAL_GROUND,
+	MATERIAL_SUPPORT,
+	MATERIAL_RAIL,
+	MATERIAL_TIE,
+	MATERIAL_WHEEL,
+	MATERIAL_CONTROL,
+	MATERIAL_SELECTED,
+	MATERIAL_PREVIEW,
+	MATERIAL_COUNT
+};
+
+/* std140 layout of one entry of the Materials block in the shaders */
+struct Material{
+	vec4 colour;
+	vec4 surface;	//ambient, specular, shininess, 1 if lit or 0 to show the colour as is
+};
+
+/* The material constants, loaded once into a uniform buffer that every program reads
+ * through the Materials block. Must match MAX_MATERIALS in the shaders */
+class MaterialTable{
+public:
+	static const int maxMaterials = 16;
+	static const GLuint binding = 0;
+
+	MaterialTable(): buffer(0){}
+
+	void init();
+	/* points a program's Materials block at the buffer, again after it is rebuilt */
+	void attach(GLuint program) const;
+	void release();
+
+private:
+	GLuint buffer;
+};
+
+#endif
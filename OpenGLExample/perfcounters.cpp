@@ -0,0 +1,187 @@
+#include "perfcounters.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+using namespace std;
+
+static const char* counterNames[PERF_COUNTER_COUNT] = {"cycles", "instructions", "cache misses", "branch misses"};
+
+PerfCounters::PerfCounters(): current(-1)
+{
+	for(int c = 0; c < PERF_COUNTER_COUNT; c++)
+		fds[c] = -1;
+}
+
+PerfCounters::~PerfCounters()
+{
+	close();
+}
+
+#ifdef __linux__
+
+int PerfCounters::open()
+{
+	static const unsigned long long configs[PERF_COUNTER_COUNT] = {PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+	close();
+	int opened = 0;
+	for(int c = 0; c < PERF_COUNTER_COUNT; c++)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[c];
+		attr.exclude_kernel = 1;	//all perf_event_paranoid 2 allows
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		/* this thread on whichever cpu it runs*/
+		fds[c] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if(fds[c] >= 0)
+			opened++;
+	}
+	if(opened < PERF_COUNTER_COUNT)
+		cout << "Opened " << opened << " of " << PERF_COUNTER_COUNT << " hardware counters, check /proc/sys/kernel/perf_event_paranoid" << endl;
+	return opened;
+}
+
+void PerfCounters::close()
+{
+	for(int c = 0; c < PERF_COUNTER_COUNT; c++)
+	{
+		if(fds[c] >= 0)
+			::close(fds[c]);
+		fds[c] = -1;
+	}
+}
+
+void PerfCounters::read(Reading* readings) const
+{
+	for(int c = 0; c < PERF_COUNTER_COUNT; c++)
+	{
+		Reading& r = readings[c];
+		r.value = r.enabled = r.running = 0;
+		if(fds[c] >= 0 && ::read(fds[c], &r, sizeof(r)) != sizeof(r))
+			r.value = r.enabled = r.running = 0;
+	}
+}
+
+#else
+
+int PerfCounters::open()
+{
+	cout << "Hardware counters need Linux perf_event_open, only times are reported" << endl;
+	return 0;
+}
+
+void PerfCounters::close()
+{
+}
+
+void PerfCounters::read(Reading* readings) const
+{
+	for(int c = 0; c < PERF_COUNTER_COUNT; c++)
+		readings[c].value = readings[c].enabled = readings[c].running = 0;
+}
+
+#endif
+
+void PerfCounters::begin(const string& stage)
+{
+	current = -1;
+	for(size_t s = 0; s < stages.size(); s++)
+		if(stages[s].name == stage)
+			current = s;
+	if(current < 0)
+	{
+		Stage added;
+		added.name = stage;
+		added.runs = 0;
+		added.seconds = 0;
+		for(int c = 0; c < PERF_COUNTER_COUNT; c++)
+			added.counts[c] = 0;
+		current = stages.size();
+		stages.push_back(added);
+	}
+
+	/* read last so the bookkeeping above isn't counted*/
+	startTime = chrono::steady_clock::now();
+	read(started);
+}
+
+void PerfCounters::end()
+{
+	Reading ended[PERF_COUNTER_COUNT];
+	read(ended);
+	chrono::steady_clock::time_point endTime = chrono::steady_clock::now();
+	if(current < 0)
+		return;
+
+	Stage& stage = stages[current];
+	stage.runs++;
+	stage.seconds += chrono::duration<double>(endTime - startTime).count();
+	for(int c = 0; c < PERF_COUNTER_COUNT; c++)
+	{
+		double value = double(ended[c].value - started[c].value);
+		double enabled = double(ended[c].enabled - started[c].enabled);
+		double running = double(ended[c].running - started[c].running);
+		stage.counts[c] += (running > 0) ? value*enabled/running : value;
+	}
+	current = -1;
+}
+
+void PerfCounters::printReport() const
+{
+	cout << left << setw(24) << "stage" << right << setw(6) << "runs" << setw(12) << "ms/run";
+	for(int c = 0; c < PERF_COUNTER_COUNT; c++)
+		cout << setw(15) << counterNames[c];
+	cout << setw(8) << "IPC" << setw(12) << "LLC/kinst" << setw(12) << "br/kinst" << endl;
+
+	for(size_t s = 0; s < stages.size(); s++)
+	{
+		const Stage& stage = stages[s];
+		int runs = std::max(stage.runs, 1);
+		cout << left << setw(24) << stage.name << right << setw(6) << stage.runs
+			 << setw(12) << fixed << setprecision(3) << stage.seconds*1000.0/runs;
+
+		/* per run, so stages run different numbers of times compare*/
+		cout << setprecision(0);
+		for(int c = 0; c < PERF_COUNTER_COUNT; c++)
+		{
+			if(available(PerfCounter(c)))
+				cout << setw(15) << stage.counts[c]/runs;
+			else
+				cout << setw(15) << "n/a";
+		}
+
+		double instructions = stage.counts[PERF_INSTRUCTIONS];
+		bool ratios = available(PERF_INSTRUCTIONS) && instructions > 0;
+		cout << setprecision(2);
+		if(ratios && available(PERF_CYCLES) && stage.counts[PERF_CYCLES] > 0)
+			cout << setw(8) << instructions/stage.counts[PERF_CYCLES];
+		else
+			cout << setw(8) << "n/a";
+		if(ratios && available(PERF_CACHE_MISSES))
+			cout << setw(12) << 1000.0*stage.counts[PERF_CACHE_MISSES]/instructions;
+		else
+			cout << setw(12) << "n/a";
+		if(ratios && available(PERF_BRANCH_MISSES))
+			cout << setw(12) << 1000.0*stage.counts[PERF_BRANCH_MISSES]/instructions;
+		else
+			cout << setw(12) << "n/a";
+		cout << endl;
+	}
+	cout.unsetf(ios::floatfield);
+	cout << setprecision(6);
+}
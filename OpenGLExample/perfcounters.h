@@ -0,0 +1,67 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+enum PerfCounter{
+	PERF_CYCLES = 0,
+	PERF_INSTRUCTIONS,
+	PERF_CACHE_MISSES,		//last level cache
+	PERF_BRANCH_MISSES,
+	PERF_COUNTER_COUNT
+};
+
+/* Hardware counters of the calling thread, summed per named stage, read through Linux
+ * perf_event_open in user space only. A counter the kernel or the machine won't give,
+ * through perf_event_paranoid, a container or another OS, reads as unavailable and the
+ * stage keeps its wall clock time. Counters the PMU had to share are scaled up to the
+ * whole stage. */
+class PerfCounters{
+public:
+	PerfCounters();
+	~PerfCounters();
+
+	/* returns how many of the counters opened */
+	int open();
+	void close();
+	bool available(PerfCounter counter) const { return fds[counter] >= 0; }
+
+	/* stages are reported in the order they were first begun, runs of one name add up */
+	void begin(const std::string& stage);
+	void end();
+
+	void printReport() const;
+
+private:
+	struct Reading{
+		unsigned long long value, enabled, running;
+	};
+	struct Stage{
+		std::string name;
+		int runs;
+		double seconds;
+		double counts[PERF_COUNTER_COUNT];
+	};
+
+	void read(Reading* readings) const;
+
+	int fds[PERF_COUNTER_COUNT];
+	std::vector<Stage> stages;
+	int current;
+	Reading started[PERF_COUNTER_COUNT];
+	std::chrono::steady_clock::time_point startTime;
+};
+
+/* counts the rest of the enclosing scope as stage */
+class PerfStage{
+public:
+	PerfStage(PerfCounters& _counters, const std::string& stage): counters(_counters) { counters.begin(stage); }
+	~PerfStage() { counters.end(); }
+
+private:
+	PerfCounters& counters;
+};
+
+#endif
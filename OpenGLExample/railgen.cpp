@@ -0,0 +1,158 @@
+#include "railgen.h"
+#include "shaders.h"
+#include "bake.h"
+#include "glstate.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/* a texture buffer on unit reading buffer as one vec3 a texel*/
+static void createPointTexture(GLint unit, GLuint* buffer, GLuint* texture)
+{
+	glGenBuffers(1, buffer);
+	glGenTextures(1, texture);
+	glState.bindTexture(unit, GL_TEXTURE_BUFFER, *texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, *buffer);
+}
+
+bool RailGenerator::init(ShaderManager& shaders, const string& vertexFile)
+{
+	vector<string> varyings;
+	varyings.push_back("PosRail");
+	varyings.push_back("NegRail");
+	varyings.push_back("Tie");
+	program = shaders.loadFeedback("rails", vertexFile, varyings);
+	if(!program)
+		return false;
+	loadUniforms();
+
+	/* the draws read no attributes, but the core profile wants a vertex array bound*/
+	glGenVertexArrays(1, &vao);
+	createPointTexture(curveUnit, &curveBuffer, &curveTexture);
+	createPointTexture(binormalUnit, &binormalBuffer, &binormalTexture);
+	return true;
+}
+
+void RailGenerator::programChanged(const ShaderManager& shaders)
+{
+	if(!ready())
+		return;
+	program = shaders.get("rails");
+	loadUniforms();
+}
+
+void RailGenerator::loadUniforms()
+{
+	glState.useProgram(program);
+	glUniform1i(glGetUniformLocation(program, "curvePoints"), curveUnit);
+	glUniform1i(glGetUniformLocation(program, "binormals"), binormalUnit);
+	glUniform1f(glGetUniformLocation(program, "railOffset"), railOffset);
+	glState.useProgram(0);
+}
+
+/* the program belongs to the ShaderManager, which deletes it*/
+void RailGenerator::release()
+{
+	glDeleteVertexArrays(1, &vao);
+	glDeleteTextures(1, &curveTexture);
+	glDeleteTextures(1, &binormalTexture);
+	glDeleteBuffers(1, &curveBuffer);
+	glDeleteBuffers(1, &binormalBuffer);
+	program = vao = curveTexture = binormalTexture = curveBuffer = binormalBuffer = 0;
+}
+
+/* loads count points and binormals from first on into the texture buffers, which are already sized*/
+void RailGenerator::loadPoints(const vector<vec3>& curve, const vector<mat3>& frames, int first, int count)
+{
+	vector<vec3> binormals(count);
+	for(int k = 0; k < count; k++)
+		binormals[k] = frames[first + k][0];
+
+	glState.bindBuffer(GL_TEXTURE_BUFFER, curveBuffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, sizeof(vec3)*first, sizeof(vec3)*count, &curve[first]);
+	glState.bindBuffer(GL_TEXTURE_BUFFER, binormalBuffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, sizeof(vec3)*first, sizeof(vec3)*count, &binormals[0]);
+	glState.bindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void RailGenerator::build(const vector<vec3>& curve, const vector<mat3>& frames,
+						GLuint posRail, GLuint negRail, GLuint ties)
+{
+	points = curve.size();
+	if(points == 0)
+		return;
+
+	/* every buffer gets the ties' length, the rails' extra entry is never drawn*/
+	int outputs = points + points%2;
+	GLuint outputBuffers[3] = {posRail, negRail, ties};
+	for(int b = 0; b < 3; b++)
+	{
+		glState.bindBuffer(GL_ARRAY_BUFFER, outputBuffers[b]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vec3)*outputs, 0, GL_STATIC_DRAW);
+	}
+	GLuint inputBuffers[2] = {curveBuffer, binormalBuffer};
+	for(int b = 0; b < 2; b++)
+	{
+		glState.bindBuffer(GL_TEXTURE_BUFFER, inputBuffers[b]);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(vec3)*points, 0, GL_STATIC_DRAW);
+	}
+
+	loadPoints(curve, frames, 0, points);
+	generate(0, outputs, posRail, negRail, ties);
+}
+
+void RailGenerator::update(const vector<vec3>& curve, const vector<mat3>& frames, int first, int count,
+						GLuint posRail, GLuint negRail, GLuint ties)
+{
+	if((int)curve.size() != points || count >= points)
+	{
+		build(curve, frames, posRail, negRail, ties);
+		return;
+	}
+
+	first = ((first % points) + points) % points;
+	int tail = std::min(count, points - first);
+	loadPoints(curve, frames, first, tail);
+	if(count > tail)
+		loadPoints(curve, frames, 0, count - tail);
+
+	/* the ties start on even points, and the one before first may use its binormal*/
+	int outputs = points + points%2;
+	int from = first - first%2;
+	int length = std::min(count + 2, outputs);
+	int end = std::min(from + length, outputs);
+	generate(from, end - from, posRail, negRail, ties);
+	if(from + length > outputs)
+		generate(0, from + length - outputs, posRail, negRail, ties);
+}
+
+/* runs the program over outputs first to first + count - 1, capturing them into the buffers
+ * at the same place*/
+void RailGenerator::generate(int first, int count, GLuint posRail, GLuint negRail, GLuint ties)
+{
+	if(count <= 0)
+		return;
+
+	glState.useProgram(program);
+	glUniform1i(glGetUniformLocation(program, "pointCount"), points);
+	glState.bindTexture(curveUnit, GL_TEXTURE_BUFFER, curveTexture);
+	glState.bindTexture(binormalUnit, GL_TEXTURE_BUFFER, binormalTexture);
+
+	GLuint outputBuffers[3] = {posRail, negRail, ties};
+	for(int b = 0; b < 3; b++)
+		glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, b, outputBuffers[b], sizeof(vec3)*first, sizeof(vec3)*count);
+
+	glState.bindVertexArray(vao);
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, first, count);
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	/* the frame graph expects nothing bound between frames*/
+	for(int b = 0; b < 3; b++)
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, b, 0);
+	glState.bindVertexArray(0);
+	glState.useProgram(0);
+}
@@ -0,0 +1,49 @@
+#ifndef RAILGEN_H
+#define RAILGEN_H
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include <vector>
+#include <string>
+
+class ShaderManager;
+
+using namespace glm;
+
+/* Builds the rails and ties on the GPU with transform feedback. The centreline and the
+ * binormal of each baked frame sit in texture buffers, one vertex per point reads them
+ * and writes both rails and the ties into the buffers the track is drawn from, so the
+ * geometry is never on the CPU. An edit loads the points it moved and regenerates only
+ * their stretch. The program is the ShaderManager's, cached and reloaded like the others. */
+class RailGenerator{
+public:
+	static const GLint curveUnit = 4, binormalUnit = 5;	//after the lap table
+
+	RailGenerator(): program(0), vao(0), curveBuffer(0), curveTexture(0), binormalBuffer(0),
+					binormalTexture(0), points(0){}
+
+	/* loads the program from vertexFile through shaders, returns false if it does not build */
+	bool init(ShaderManager& shaders, const std::string& vertexFile);
+	/* takes the program shaders rebuilt after its source changed */
+	void programChanged(const ShaderManager& shaders);
+	void release();
+	bool ready() const { return program != 0; }
+
+	/* loads a new curve and its frames, sizes the three buffers for it and fills them */
+	void build(const std::vector<vec3>& curve, const std::vector<mat3>& frames,
+				GLuint posRail, GLuint negRail, GLuint ties);
+	/* after count points from first on and their frames moved, wrapping past the end */
+	void update(const std::vector<vec3>& curve, const std::vector<mat3>& frames, int first, int count,
+				GLuint posRail, GLuint negRail, GLuint ties);
+
+private:
+	void loadPoints(const std::vector<vec3>& curve, const std::vector<mat3>& frames, int first, int count);
+	void generate(int first, int count, GLuint posRail, GLuint negRail, GLuint ties);
+	void loadUniforms();
+
+	GLuint program, vao;
+	GLuint curveBuffer, curveTexture, binormalBuffer, binormalTexture;
+	int points;
+};
+
+#endif
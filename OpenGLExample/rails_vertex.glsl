@@ -0,0 +1,35 @@
+// ==========================================================================
+// Vertex program generating the rails and ties
+//
+// Run over one point per vertex with the rasterizer off, the outputs are
+// captured with transform feedback straight into the rail and tie buffers.
+// Matches the rails bakeRails() builds on the CPU
+// ==========================================================================
+#version 410
+
+uniform samplerBuffer curvePoints;
+uniform samplerBuffer binormals;
+uniform int pointCount;
+uniform float railOffset;
+
+out vec3 PosRail;
+out vec3 NegRail;
+out vec3 Tie;		// ties[j] and ties[j + 1] join the rails at every even j
+
+vec3 railSide(int i)
+{
+	return texelFetch(binormals, i).xyz*railOffset;
+}
+
+void main()
+{
+	// with an odd number of points the last tie runs one past the rails
+	int i = min(gl_VertexID, pointCount - 1);
+	vec3 centre = texelFetch(curvePoints, i).xyz;
+	PosRail = centre + railSide(i);
+	NegRail = centre - railSide(i);
+
+	int j = gl_VertexID - gl_VertexID%2;
+	vec3 tieCentre = texelFetch(curvePoints, j).xyz;
+	Tie = (gl_VertexID%2 == 0) ? tieCentre - railSide(j) : tieCentre + railSide(j);
+}
@@ -0,0 +1,179 @@
+#include "replay.h"
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static const uint32_t maxFrames = 1u << 24;	//anything longer is a damaged file
+
+static void writeVec(ofstream& out, const vec3& v)
+{
+	out.write((const char*)&v[0], 3*sizeof(float));
+}
+
+static bool readVec(ifstream& in, vec3* v)
+{
+	return (bool)in.read((char*)&(*v)[0], 3*sizeof(float));
+}
+
+bool CameraRecording::save(const string& filename) const
+{
+	ofstream out(filename.c_str(), ios::binary);
+	if(!out.is_open())
+	{
+		cout << "Could not open " << filename << " for the camera recording" << endl;
+		return false;
+	}
+
+	uint32_t count = samples.size();
+	out.write("CREC", 4);
+	out.write((const char*)&count, sizeof(count));
+	for(size_t f = 0; f < samples.size(); f++)
+	{
+		const CameraSample& s = samples[f];
+		writeVec(out, s.dir);
+		writeVec(out, s.right);
+		writeVec(out, s.up);
+		writeVec(out, s.pos);
+		out.write((const char*)&s.dt, sizeof(s.dt));
+		out.write((const char*)&s.play, sizeof(s.play));
+	}
+
+	if(out.good())
+		cout << "Recorded " << count << " frames to " << filename << endl;
+	return out.good();
+}
+
+bool CameraRecording::load(const string& filename)
+{
+	ifstream in(filename.c_str(), ios::binary);
+	char magic[4];
+	uint32_t count;
+	if(!in.read(magic, 4) || memcmp(magic, "CREC", 4) != 0
+		|| !in.read((char*)&count, sizeof(count)) || count > maxFrames)
+	{
+		cout << "Could not read the camera recording " << filename << endl;
+		return false;
+	}
+
+	samples.resize(count);
+	for(uint32_t f = 0; f < count; f++)
+	{
+		CameraSample& s = samples[f];
+		if(!readVec(in, &s.dir) || !readVec(in, &s.right) || !readVec(in, &s.up) || !readVec(in, &s.pos)
+			|| !in.read((char*)&s.dt, sizeof(s.dt)) || !in.read((char*)&s.play, sizeof(s.play)))
+		{
+			cout << "Camera recording " << filename << " ends after " << f << " of " << count << " frames" << endl;
+			samples.resize(f);
+			return f > 0;
+		}
+	}
+	return true;
+}
+
+/* nearest rank percentile of sorted times*/
+static float percentile(const vector<float>& sorted, float p)
+{
+	size_t rank = (size_t)(p/100.0f*(sorted.size() - 1) + 0.5f);
+	return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+FrameTimeSummary summariseFrameTimes(vector<float> milliseconds)
+{
+	FrameTimeSummary summary;
+	if(milliseconds.empty())
+		return summary;
+
+	sort(milliseconds.begin(), milliseconds.end());
+	double total = 0;
+	for(size_t f = 0; f < milliseconds.size(); f++)
+		total += milliseconds[f];
+
+	summary.frames = milliseconds.size();
+	summary.mean = total/milliseconds.size();
+	summary.p50 = percentile(milliseconds, 50);
+	summary.p90 = percentile(milliseconds, 90);
+	summary.p95 = percentile(milliseconds, 95);
+	summary.p99 = percentile(milliseconds, 99);
+	summary.max = milliseconds.back();
+	return summary;
+}
+
+void printFrameTimes(const FrameTimeSummary& s)
+{
+	streamsize precision = cout.precision();
+	cout << fixed << setprecision(2);
+	cout << "Frame times over " << s.frames << " frames (ms): mean " << s.mean << ", p50 " << s.p50
+		 << ", p90 " << s.p90 << ", p95 " << s.p95 << ", p99 " << s.p99 << ", max " << s.max << endl;
+	cout.unsetf(ios::floatfield);
+	cout.precision(precision);
+}
+
+bool writeFrameTimes(const string& filename, const FrameTimeSummary& s)
+{
+	ofstream out(filename.c_str());
+	if(!out.is_open())
+	{
+		cout << "Could not open " << filename << " for the frame times" << endl;
+		return false;
+	}
+
+	out << "frames " << s.frames << "\n" << "mean " << s.mean << "\n" << "p50 " << s.p50 << "\n"
+		<< "p90 " << s.p90 << "\n" << "p95 " << s.p95 << "\n" << "p99 " << s.p99 << "\n"
+		<< "max " << s.max << "\n";
+	return out.good();
+}
+
+bool readFrameTimes(const string& filename, FrameTimeSummary* s)
+{
+	ifstream in(filename.c_str());
+	if(!in.is_open())
+	{
+		cout << "Could not open the frame times " << filename << endl;
+		return false;
+	}
+
+	string name;
+	float value;
+	while(in >> name >> value)
+	{
+		if(name == "frames") s->frames = (int)value;
+		else if(name == "mean") s->mean = value;
+		else if(name == "p50") s->p50 = value;
+		else if(name == "p90") s->p90 = value;
+		else if(name == "p95") s->p95 = value;
+		else if(name == "p99") s->p99 = value;
+		else if(name == "max") s->max = value;
+	}
+	return s->frames > 0;
+}
+
+static void compareLine(const char* name, float baseline, float current)
+{
+	float change = (baseline > 0) ? 100.0f*(current - baseline)/baseline : 0.0f;
+	cout << "  " << setw(5) << name << setw(10) << baseline << setw(10) << current
+		 << setw(9) << showpos << change << "%" << noshowpos << endl;
+}
+
+void compareFrameTimes(const FrameTimeSummary& baseline, const FrameTimeSummary& current)
+{
+	if(baseline.frames != current.frames)
+		cout << "Baseline has " << baseline.frames << " frames, this run " << current.frames
+			 << ", the runs may not be the same recording" << endl;
+
+	streamsize precision = cout.precision();
+	cout << fixed << setprecision(2);
+	cout << "Frame times (ms)   baseline   current   change" << endl;
+	compareLine("mean", baseline.mean, current.mean);
+	compareLine("p50", baseline.p50, current.p50);
+	compareLine("p90", baseline.p90, current.p90);
+	compareLine("p95", baseline.p95, current.p95);
+	compareLine("p99", baseline.p99, current.p99);
+	compareLine("max", baseline.max, current.max);
+	cout.unsetf(ios::floatfield);
+	cout.precision(precision);
+}
@@ -0,0 +1,52 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "glm/glm.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using namespace glm;
+
+/* The input of one frame: the camera, whether the cart is running and how far the
+ * simulation stepped, so a replay draws the same frames whatever its frame rate */
+struct CameraSample{
+	vec3 dir, right, up, pos;
+	float dt;			//simulated seconds
+	uint8_t play;
+};
+
+/* Every frame's input from the track being ready until the window closed.
+ * The file is "CREC", the frame count, then one packed 53 byte record per frame */
+class CameraRecording{
+public:
+	void add(const CameraSample& sample) { samples.push_back(sample); }
+	size_t size() const { return samples.size(); }
+	const CameraSample& operator[](size_t frame) const { return samples[frame]; }
+
+	bool save(const std::string& filename) const;
+	bool load(const std::string& filename);
+
+private:
+	std::vector<CameraSample> samples;
+};
+
+/* Distribution of frame times in milliseconds */
+struct FrameTimeSummary{
+	int frames;
+	float mean, p50, p90, p95, p99, max;
+
+	FrameTimeSummary(): frames(0), mean(0), p50(0), p90(0), p95(0), p99(0), max(0){}
+};
+
+FrameTimeSummary summariseFrameTimes(std::vector<float> milliseconds);
+void printFrameTimes(const FrameTimeSummary& summary);
+
+/* one "name value" line per field, so summaries from two builds can be compared */
+bool writeFrameTimes(const std::string& filename, const FrameTimeSummary& summary);
+bool readFrameTimes(const std::string& filename, FrameTimeSummary* summary);
+
+/* prints each percentile of current next to the baseline's and the change */
+void compareFrameTimes(const FrameTimeSummary& baseline, const FrameTimeSummary& current);
+
+#endif
@@ -0,0 +1,362 @@
+#include "shaders.h"
+#include "trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+using namespace std;
+
+/* program binaries are core in 4.1, past what the glad loader covers*/
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT	0x8257
+#define GL_PROGRAM_BINARY_LENGTH			0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS		0x87FE
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* format, void* binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum format, const void* binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+static GetProgramBinaryProc getProgramBinary = 0;
+static ProgramBinaryProc programBinary = 0;
+static ProgramParameteriProc programParameteri = 0;
+
+static const char cacheMagic[4] = {'S', 'H', 'D', 'R'};
+static const uint32_t maxBinaryLength = 64u << 20;	//anything longer is a damaged cache file
+
+/* 64 bit FNV-1a, continuing from hash*/
+static uint64_t hashString(const string& text, uint64_t hash = 14695981039346656037ULL)
+{
+	for(size_t i = 0; i < text.size(); i++)
+	{
+		hash ^= (unsigned char)text[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static bool linked(GLuint program)
+{
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	return status == GL_TRUE;
+}
+
+// --------------------------------------------------------------------------
+// OpenGL shader support functions
+
+// reads a text file with the given name into a string
+string LoadSource(const string &filename)
+{
+    string source;
+
+    ifstream input(filename.c_str());
+    if (input) {
+        copy(istreambuf_iterator<char>(input),
+             istreambuf_iterator<char>(),
+             back_inserter(source));
+        input.close();
+    }
+    else {
+        cout << "ERROR: Could not load shader source from file "
+             << filename << endl;
+    }
+
+    return source;
+}
+
+// creates and returns a shader object compiled from the given source, or 0 if it fails
+GLuint CompileShader(GLenum shaderType, const string &source, const string &filename)
+{
+    // allocate shader object name
+    GLuint shaderObject = glCreateShader(shaderType);
+
+    // try compiling the source as a shader of the given type
+    const GLchar *source_ptr = source.c_str();
+    glShaderSource(shaderObject, 1, &source_ptr, 0);
+    glCompileShader(shaderObject);
+
+    // retrieve compile status
+    GLint status;
+    glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &status);
+    if (status == GL_FALSE)
+    {
+        GLint length;
+        glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &length);
+        string info(length, ' ');
+        glGetShaderInfoLog(shaderObject, info.length(), &length, &info[0]);
+        cout << "ERROR compiling shader " << filename << ":" << endl;
+        cout << info << endl;
+
+        glDeleteShader(shaderObject);
+        return 0;
+    }
+
+    return shaderObject;
+}
+
+// creates and returns a program object linked from vertex and fragment shaders, or 0 if it fails
+GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader)
+{
+    // allocate program object name
+    GLuint programObject = glCreateProgram();
+
+    // attach provided shader objects to this program
+    if (vertexShader)   glAttachShader(programObject, vertexShader);
+    if (fragmentShader) glAttachShader(programObject, fragmentShader);
+
+    // ask the driver to keep the binary around for the cache
+    if (programParameteri)
+        programParameteri(programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    // try linking the program with given attachments
+    glLinkProgram(programObject);
+
+    // retrieve link status
+    if (!linked(programObject))
+    {
+        GLint length;
+        glGetProgramiv(programObject, GL_INFO_LOG_LENGTH, &length);
+        string info(length, ' ');
+        glGetProgramInfoLog(programObject, info.length(), &length, &info[0]);
+        cout << "ERROR linking shader program:" << endl;
+        cout << info << endl;
+
+        glDeleteProgram(programObject);
+        return 0;
+    }
+
+    return programObject;
+}
+
+// creates and returns a vertex only program capturing varyings, or 0 if it fails
+GLuint LinkFeedbackProgram(GLuint vertexShader, const vector<string>& varyings)
+{
+    GLuint programObject = glCreateProgram();
+    glAttachShader(programObject, vertexShader);
+
+    // ask the driver to keep the binary around for the cache
+    if (programParameteri)
+        programParameteri(programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    // the varyings are fixed at link time, one buffer binding each in the order given
+    vector<const GLchar*> names;
+    for (size_t v = 0; v < varyings.size(); v++)
+        names.push_back(varyings[v].c_str());
+    glTransformFeedbackVaryings(programObject, names.size(), &names[0], GL_SEPARATE_ATTRIBS);
+    glLinkProgram(programObject);
+
+    if (!linked(programObject))
+    {
+        GLint length;
+        glGetProgramiv(programObject, GL_INFO_LOG_LENGTH, &length);
+        string info(length, ' ');
+        glGetProgramInfoLog(programObject, info.length(), &length, &info[0]);
+        cout << "ERROR linking transform feedback program:" << endl;
+        cout << info << endl;
+
+        glDeleteProgram(programObject);
+        return 0;
+    }
+
+    return programObject;
+}
+
+// ==========================================================================
+// ShaderManager
+
+void ShaderManager::init(GLADloadproc load, const string& directory)
+{
+	getProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+	programBinary = (ProgramBinaryProc)load("glProgramBinary");
+	programParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+
+	/* some drivers export the calls but support no binary formats*/
+	GLint formats = 0;
+	if(getProgramBinary && programBinary)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	binaries = formats > 0;
+	glGetError();
+
+	driver = string((const char*)glGetString(GL_VENDOR)) + "|" +
+			 (const char*)glGetString(GL_RENDERER) + "|" +
+			 (const char*)glGetString(GL_VERSION);
+
+	cacheDirectory = directory;
+#ifdef _WIN32
+	_mkdir(cacheDirectory.c_str());
+#else
+	mkdir(cacheDirectory.c_str(), 0755);
+#endif
+
+	if(!binaries)
+		cout << "Program binaries unsupported, shaders compile on every start" << endl;
+}
+
+string ShaderManager::cachePath(const string& name) const
+{
+	return cacheDirectory + "/" + name + ".bin";
+}
+
+/* loads from the cache when the key matches, otherwise compiles, links and saves*/
+GLuint ShaderManager::build(const string& name, const Program& files)
+{
+	TRACE_ZONE("ShaderManager::build");
+	string vertexSource = LoadSource(files.vertexFile);
+	string fragmentSource = files.fragmentFile.empty() ? string() : LoadSource(files.fragmentFile);
+	uint64_t key = hashString(fragmentSource, hashString(vertexSource, hashString(driver)));
+	for(size_t v = 0; v < files.varyings.size(); v++)
+		key = hashString(files.varyings[v], key);
+
+	if(binaries)
+	{
+		ifstream in(cachePath(name).c_str(), ios::binary);
+		char magic[4];
+		uint64_t storedKey;
+		uint32_t format, length;
+		if(in.read(magic, 4) && equal(magic, magic + 4, cacheMagic)
+			&& in.read((char*)&storedKey, sizeof(storedKey)) && storedKey == key
+			&& in.read((char*)&format, sizeof(format)) && in.read((char*)&length, sizeof(length)))
+		{
+			vector<char> binary(std::min<uint32_t>(length, maxBinaryLength));
+			if(length > 0 && length <= maxBinaryLength && in.read(&binary[0], length))
+			{
+				GLuint program = glCreateProgram();
+				programBinary(program, format, &binary[0], length);
+
+				/* a driver update can reject binaries it wrote, then it is compiled again*/
+				if(linked(program))
+				{
+					fromCache++;
+					return program;
+				}
+				glDeleteProgram(program);
+			}
+		}
+		glGetError();
+	}
+
+	GLuint program = 0;
+	GLuint vertexID = CompileShader(GL_VERTEX_SHADER, vertexSource, files.vertexFile);
+	if(files.fragmentFile.empty())
+		program = vertexID ? LinkFeedbackProgram(vertexID, files.varyings) : 0;
+	else
+	{
+		GLuint fragmentID = CompileShader(GL_FRAGMENT_SHADER, fragmentSource, files.fragmentFile);
+		program = (vertexID && fragmentID) ? LinkProgram(vertexID, fragmentID) : 0;
+		glDeleteShader(fragmentID);
+	}
+	glDeleteShader(vertexID);
+	if(!program)
+		return 0;
+	compiled++;
+
+	if(binaries)
+	{
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		vector<char> binary(length);
+		GLenum format = 0;
+		if(length > 0)
+			getProgramBinary(program, length, &length, &format, &binary[0]);
+
+		ofstream out(cachePath(name).c_str(), ios::binary);
+		if(length > 0 && out)
+		{
+			uint32_t storedFormat = format, storedLength = length;
+			out.write(cacheMagic, 4);
+			out.write((const char*)&key, sizeof(key));
+			out.write((const char*)&storedFormat, sizeof(storedFormat));
+			out.write((const char*)&storedLength, sizeof(storedLength));
+			out.write(&binary[0], length);
+		}
+	}
+
+	return program;
+}
+
+GLuint ShaderManager::load(const string& name, const string& vertexFile, const string& fragmentFile)
+{
+	Program& program = programs[name];
+	program.vertexFile = vertexFile;
+	program.fragmentFile = fragmentFile;
+	program.id = build(name, program);
+
+	if(!program.id)
+		cout << "ERROR: shader program " << name << " did not build" << endl;
+	return program.id;
+}
+
+GLuint ShaderManager::loadFeedback(const string& name, const string& vertexFile, const vector<string>& varyings)
+{
+	Program& program = programs[name];
+	program.vertexFile = vertexFile;
+	program.fragmentFile.clear();
+	program.varyings = varyings;
+	program.id = build(name, program);
+
+	if(!program.id)
+		cout << "ERROR: shader program " << name << " did not build" << endl;
+	return program.id;
+}
+
+GLuint ShaderManager::get(const string& name) const
+{
+	map<string, Program>::const_iterator found = programs.find(name);
+	return (found == programs.end()) ? 0 : found->second.id;
+}
+
+bool ShaderManager::reload(const string& file)
+{
+	bool changed = false;
+	for(map<string, Program>::iterator p = programs.begin(); p != programs.end(); p++)
+	{
+		Program& program = p->second;
+		if(program.vertexFile != file && program.fragmentFile != file)
+			continue;
+
+		GLuint rebuilt = build(p->first, program);
+		if(!rebuilt)
+		{
+			cout << "Keeping the previous " << p->first << " program" << endl;
+			continue;
+		}
+
+		glDeleteProgram(program.id);
+		program.id = rebuilt;
+		changed = true;
+		cout << "Reloaded " << p->first << " program" << endl;
+	}
+	return changed;
+}
+
+vector<string> ShaderManager::files() const
+{
+	vector<string> result;
+	for(map<string, Program>::const_iterator p = programs.begin(); p != programs.end(); p++)
+	{
+		if(find(result.begin(), result.end(), p->second.vertexFile) == result.end())
+			result.push_back(p->second.vertexFile);
+		if(!p->second.fragmentFile.empty()
+			&& find(result.begin(), result.end(), p->second.fragmentFile) == result.end())
+			result.push_back(p->second.fragmentFile);
+	}
+	return result;
+}
+
+void ShaderManager::printStats() const
+{
+	cout << "Shaders: " << fromCache << " loaded from the cache, " << compiled << " compiled" << endl;
+}
+
+void ShaderManager::release()
+{
+	for(map<string, Program>::iterator p = programs.begin(); p != programs.end(); p++)
+		glDeleteProgram(p->second.id);
+	programs.clear();
+}
@@ -0,0 +1,59 @@
+#ifndef SHADERS_H
+#define SHADERS_H
+
+#include "glad/glad.h"
+#include <string>
+#include <vector>
+#include <map>
+
+/* reads a text file with the given name into a string */
+std::string LoadSource(const std::string &filename);
+/* compile or link, returning 0 and printing the log on failure */
+GLuint CompileShader(GLenum shaderType, const std::string &source, const std::string &filename);
+GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader);
+/* a vertex only program that writes varyings to one transform feedback buffer each */
+GLuint LinkFeedbackProgram(GLuint vertexShader, const std::vector<std::string>& varyings);
+
+/* Named programs built from vertex and fragment files, or from a vertex file alone for
+ * transform feedback. A linked program is saved with glGetProgramBinary under a key hashed
+ * from its sources and the driver, and loaded back with glProgramBinary while neither has
+ * changed, so startup skips the compiler. */
+class ShaderManager{
+public:
+	ShaderManager(): binaries(false), fromCache(0), compiled(0){}
+
+	/* loads the 4.1 program binary entry points, call once the context is current */
+	void init(GLADloadproc load, const std::string& cacheDirectory);
+
+	/* builds or loads from the cache, returns the program or 0 if it does not build */
+	GLuint load(const std::string& name, const std::string& vertexFile, const std::string& fragmentFile);
+	/* a vertex only program capturing varyings, as LinkFeedbackProgram builds */
+	GLuint loadFeedback(const std::string& name, const std::string& vertexFile, const std::vector<std::string>& varyings);
+	GLuint get(const std::string& name) const;
+
+	/* rebuilds every program that uses file. A program whose new sources don't build keeps
+	 * the old one. Returns true if any program changed */
+	bool reload(const std::string& file);
+	std::vector<std::string> files() const;
+
+	void printStats() const;
+	void release();
+
+private:
+	struct Program{
+		std::string vertexFile, fragmentFile;	//no fragment file for a feedback program
+		std::vector<std::string> varyings;
+		GLuint id;
+	};
+
+	GLuint build(const std::string& name, const Program& files);
+	std::string cachePath(const std::string& name) const;
+
+	std::map<std::string, Program> programs;
+	std::string cacheDirectory;
+	std::string driver;		//vendor, renderer and version, part of every cache key
+	bool binaries;			//the driver can save and load program binaries
+	int fromCache, compiled;
+};
+
+#endif
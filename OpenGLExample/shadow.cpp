@@ -0,0 +1,129 @@
+#include "shadow.h"
+#include "glstate.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+static const GLint staticUnit = 1, dynamicUnit = 2;
+
+/* a square depth texture and a framebuffer that draws only into it, 0 if it is incomplete*/
+static GLuint createDepthTarget(int size, GLuint* texture)
+{
+	glGenTextures(1, texture);
+	glState.bindTexture(0, GL_TEXTURE_2D, *texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+
+	/* linear filtering of a compared lookup blends the four nearest tests*/
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	/* outside the map is the far plane, nothing in shadow*/
+	GLfloat border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+	glState.bindTexture(0, GL_TEXTURE_2D, 0);
+
+	GLuint framebuffer;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, *texture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		return 0;
+	}
+
+	/* a map is sampled before anything is drawn into it*/
+	glState.viewport(0, 0, size, size);
+	glDepthMask(GL_TRUE);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return framebuffer;
+}
+
+bool ShadowMaps::init(int _staticSize, int _dynamicSize)
+{
+	const int* current = glState.getViewport();
+	int viewport[4] = {current[0], current[1], current[2], current[3]};
+
+	staticSize = _staticSize;
+	dynamicSize = _dynamicSize;
+	staticTarget = createDepthTarget(staticSize, &staticTexture);
+	dynamicTarget = createDepthTarget(dynamicSize, &dynamicTexture);
+	dirty = true;
+
+	glState.viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	if(!staticTarget || !dynamicTarget)
+	{
+		cout << "ERROR: shadow map framebuffers are incomplete" << endl;
+		return false;
+	}
+	return true;
+}
+
+void ShadowMaps::release()
+{
+	glDeleteFramebuffers(1, &staticTarget);
+	glDeleteFramebuffers(1, &dynamicTarget);
+	glDeleteTextures(1, &staticTexture);
+	glDeleteTextures(1, &dynamicTexture);
+	staticTarget = dynamicTarget = staticTexture = dynamicTexture = 0;
+}
+
+void ShadowMaps::setLight(vec3 _direction)
+{
+	direction = normalize(_direction);
+	dirty = true;
+}
+
+/* an orthographic camera looking along the light at a sphere. The sphere's centre is
+ * snapped to a whole texel of a size by size map*/
+mat4 ShadowMaps::lightMatrix(vec3 centre, float radius, int size) const
+{
+	vec3 up = (std::abs(direction.y) > 0.99f) ? vec3(0.0f, 0.0f, 1.0f) : vec3(0.0f, 1.0f, 0.0f);
+	mat4 view = lookAt(vec3(0.0f), direction, up);
+
+	vec3 c = vec3(view*vec4(centre, 1.0f));
+	float texel = 2.0f*radius/size;
+	c.x = floor(c.x/texel)*texel;
+	c.y = floor(c.y/texel)*texel;
+
+	/* the view looks down -z, so the sphere spans distances -c.z +- radius*/
+	return ortho(c.x - radius, c.x + radius, c.y - radius, c.y + radius, -c.z - radius, -c.z + radius)*view;
+}
+
+void ShadowMaps::fitStatic(vec3 centre, float radius)
+{
+	staticViewProjection = lightMatrix(centre, radius, staticSize);
+	dirty = true;
+}
+
+void ShadowMaps::fitDynamic(vec3 centre, float radius)
+{
+	dynamicViewProjection = lightMatrix(centre, radius, dynamicSize);
+}
+
+void ShadowMaps::bindTextures() const
+{
+	glState.bindTexture(staticUnit, GL_TEXTURE_2D, staticTexture);
+	glState.bindTexture(dynamicUnit, GL_TEXTURE_2D, dynamicTexture);
+}
+
+void ShadowMaps::loadUniforms(GLuint program) const
+{
+	glUniform3fv(glState.uniformLocation(program, "lightDirection"), 1, &direction[0]);
+	glUniformMatrix4fv(glState.uniformLocation(program, "staticShadowMatrix"), 1, false, &staticViewProjection[0][0]);
+	glUniformMatrix4fv(glState.uniformLocation(program, "dynamicShadowMatrix"), 1, false, &dynamicViewProjection[0][0]);
+	glUniform1i(glState.uniformLocation(program, "staticShadowMap"), staticUnit);
+	glUniform1i(glState.uniformLocation(program, "dynamicShadowMap"), dynamicUnit);
+}
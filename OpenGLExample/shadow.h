@@ -0,0 +1,56 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+using namespace glm;
+
+/* Two depth maps from one directional light. The static map covers the whole scene and is
+ * only drawn again when what it covers moves, the dynamic one is small, follows the cart
+ * and holds only what moves. A point is lit where neither map has anything in front of it.
+ * Both are depth textures compared in the lookup, so the hardware filters the result. */
+class ShadowMaps{
+public:
+	ShadowMaps(): staticTexture(0), dynamicTexture(0), staticTarget(0), dynamicTarget(0),
+				staticSize(0), dynamicSize(0), dirty(true), direction(0.0f, -1.0f, 0.0f){}
+
+	/* makes the maps, cleared to nothing in shadow. Returns false if the framebuffers are incomplete */
+	bool init(int staticSize, int dynamicSize);
+	void release();
+
+	/* the direction the light travels in */
+	void setLight(vec3 direction);
+
+	/* fits the static light camera around a sphere and marks the map to be drawn again */
+	void fitStatic(vec3 centre, float radius);
+	/* fits the dynamic light camera, snapped to whole texels so the map does not shimmer */
+	void fitDynamic(vec3 centre, float radius);
+
+	bool staticDirty() const { return dirty; }
+	void staticDrawn() { dirty = false; }
+
+	const mat4& staticMatrix() const { return staticViewProjection; }
+	const mat4& dynamicMatrix() const { return dynamicViewProjection; }
+	GLuint staticFramebuffer() const { return staticTarget; }
+	GLuint dynamicFramebuffer() const { return dynamicTarget; }
+	int staticResolution() const { return staticSize; }
+	int dynamicResolution() const { return dynamicSize; }
+
+	/* binds the maps to texture units 1 and 2 */
+	void bindTextures() const;
+	/* loads the light and both maps into a program that samples them, the program must be in use */
+	void loadUniforms(GLuint program) const;
+
+private:
+	mat4 lightMatrix(vec3 centre, float radius, int size) const;
+
+	GLuint staticTexture, dynamicTexture;
+	GLuint staticTarget, dynamicTarget;
+	int staticSize, dynamicSize;
+	bool dirty;
+	vec3 direction;
+	mat4 staticViewProjection, dynamicViewProjection;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "streambuffer.h"
+#include "glstate.h"
+
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+void StreamBuffer::init(GLsizeiptr bytesPerFrame)
+{
+	sliceSize = bytesPerFrame;
+	glGenBuffers(1, &buffer);
+	glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, sliceSize*slices, 0, GL_STREAM_DRAW);
+	glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StreamBuffer::release()
+{
+	for(int s = 0; s < slices; s++)
+	{
+		if(fences[s])
+			glDeleteSync(fences[s]);
+		fences[s] = 0;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+	cursor = 0;
+	if(!fences[slice])
+		return;
+
+	/* polled first, so a stall is only counted when the GPU really is a whole ring behind*/
+	GLenum status = glClientWaitSync(fences[slice], 0, 0);
+	if(status == GL_TIMEOUT_EXPIRED)
+	{
+		stalls++;
+		do
+			status = glClientWaitSync(fences[slice], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		while(status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fences[slice]);
+	fences[slice] = 0;
+}
+
+void StreamBuffer::endFrame()
+{
+	fences[slice] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slice = (slice + 1)%slices;
+	frames++;
+}
+
+GLintptr StreamBuffer::write(const void* data, GLsizeiptr bytes, GLsizeiptr alignment)
+{
+	GLsizeiptr start = (cursor + alignment - 1)/alignment*alignment;
+	if(bytes <= 0 || start + bytes > sliceSize)
+	{
+		if(bytes > 0)
+			overflows++;
+		return -1;
+	}
+
+	/* nothing the GPU may still be reading is in the range, the fence made sure of that*/
+	GLintptr offset = slice*sliceSize + start;
+	glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+	void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+									GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if(!mapped)
+		return -1;
+	memcpy(mapped, data, bytes);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	cursor = start + bytes;
+	return offset;
+}
+
+void StreamBuffer::printStats() const
+{
+	if(frames == 0)
+		return;
+
+	cout << "Stream buffer: " << sliceSize*slices/1024 << " KB in " << slices << " slices, waited on the GPU in "
+		 << stalls << " of " << frames << " frames";
+	if(overflows > 0)
+		cout << ", " << overflows << " writes did not fit";
+	cout << endl;
+}
@@ -0,0 +1,45 @@
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include "glad/glad.h"
+
+/* One vertex buffer for everything rewritten every frame, split into a slice per frame in
+ * flight. A frame writes only into its own slice, mapped unsynchronised so the driver never
+ * waits or copies, and fences its draws when it ends. The slice is only written again once
+ * that fence has passed, which is the one place the CPU can wait for the GPU. Data written
+ * here lasts for the frame it was written in. */
+class StreamBuffer{
+public:
+	static const int slices = 3;	//frames the GPU may fall behind by
+
+	StreamBuffer(): buffer(0), sliceSize(0), slice(0), cursor(0), frames(0), stalls(0), overflows(0)
+	{
+		for(int s = 0; s < slices; s++)
+			fences[s] = 0;
+	}
+
+	void init(GLsizeiptr bytesPerFrame);
+	void release();
+
+	/* waits, if it has to, until the GPU is done with the slice this frame writes into */
+	void beginFrame();
+	/* fences the draws submitted this frame */
+	void endFrame();
+
+	/* copies bytes into the frame's slice, returns their offset in the buffer or -1 if the
+	 * slice is full. The offset is a multiple of alignment */
+	GLintptr write(const void* data, GLsizeiptr bytes, GLsizeiptr alignment = 16);
+
+	GLuint id() const { return buffer; }
+	void printStats() const;
+
+private:
+	GLuint buffer;
+	GLsizeiptr sliceSize;
+	int slice;
+	GLsizeiptr cursor;	//next free byte in the slice
+	GLsync fences[slices];
+	int frames, stalls, overflows;
+};
+
+#endif
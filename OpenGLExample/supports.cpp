@@ -0,0 +1,80 @@
+#include "supports.h"
+#include "trace.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace std;
+
+void generateBox(vec3 lo, vec3 hi, vector<vec3>* vertices, vector<vec3>* normals,
+				vector<unsigned int>* indices)
+{
+	/* corners of a face in its own u, v axes, counter clockwise looking down the axis*/
+	const int cornerU[4] = {0, 1, 1, 0};
+	const int cornerV[4] = {0, 0, 1, 1};
+	const unsigned int facing[2][6] = {{0, 2, 1, 0, 3, 2}, {0, 1, 2, 0, 2, 3}};
+
+	for(int axis = 0; axis < 3; axis++)
+	{
+		int u = (axis + 1)%3, v = (axis + 2)%3;
+		for(int side = 0; side < 2; side++)
+		{
+			vec3 normal(0.0f);
+			normal[axis] = side ? 1.0f : -1.0f;
+
+			unsigned int base = vertices->size();
+			for(int c = 0; c < 4; c++)
+			{
+				vec3 p;
+				p[axis] = side ? hi[axis] : lo[axis];
+				p[u] = cornerU[c] ? hi[u] : lo[u];
+				p[v] = cornerV[c] ? hi[v] : lo[v];
+				vertices->push_back(p);
+				normals->push_back(normal);
+			}
+			for(int i = 0; i < 6; i++)
+				indices->push_back(base + facing[side][i]);
+		}
+	}
+}
+
+/*generates the unit column that every support is drawn from*/
+void generateColumn(vector<vec3>* vertices, vector<vec3>* normals,
+					vector<unsigned int>* indices)
+{
+	generateBox(vec3(-0.5f, 0.0f, -0.5f), vec3(0.5f, 1.0f, 0.5f), vertices, normals, indices);
+}
+
+/*walks the curve by arc length and drops a column every spacing units*/
+void generateSupports(const vector<vec3>& points, float spacing, float groundHeight,
+					float width, vector<mat4>* instances)
+{
+	TRACE_ZONE("generateSupports");
+	instances->clear();
+	if(points.size() < 2 || spacing <= 0.0f)
+		return;
+
+	float travelled = 0.0f;
+	float nextSupport = 0.0f;
+
+	for(size_t i = 0; i < points.size(); i++)
+	{
+		vec3 a = points[i];
+		vec3 b = points[(i + 1) % points.size()];
+		float segLength = length(b - a);
+
+		/* a segment can be longer than the spacing on a coarse curve, so place every column that lands on it*/
+		while(nextSupport < travelled + segLength)
+		{
+			float t = (segLength > 0.0f) ? (nextSupport - travelled)/segLength : 0.0f;
+			vec3 top = a + t*(b - a);
+			float height = top.y - groundHeight;
+
+			if(height > 0.0f)
+			{
+				mat4 model = translate(mat4(1.0f), vec3(top.x, groundHeight, top.z));
+				instances->push_back(scale(model, vec3(width, height, width)));
+			}
+			nextSupport += spacing;
+		}
+		travelled += segLength;
+	}
+}
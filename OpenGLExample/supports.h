@@ -0,0 +1,24 @@
+#ifndef SUPPORTS_H
+#define SUPPORTS_H
+
+#include "glm/glm.hpp"
+#include <vector>
+
+using namespace glm;
+
+/* axis aligned box from lo to hi, four vertices per face so each face has its own normal,
+ * triangles wound counter clockwise seen from outside */
+void generateBox(vec3 lo, vec3 hi, std::vector<vec3>* vertices, std::vector<vec3>* normals,
+				std::vector<unsigned int>* indices);
+
+/* unit column, 1 unit tall with a 1x1 footprint centred on the y axis, base at the origin */
+void generateColumn(std::vector<vec3>* vertices, std::vector<vec3>* normals,
+					std::vector<unsigned int>* indices);
+
+/* places a column every spacing units of arc length along the closed curve points,
+ * reaching from groundHeight up to the curve. One model matrix per column is
+ * written to instances, for use with the unit column above. */
+void generateSupports(const std::vector<vec3>& points, float spacing, float groundHeight,
+					float width, std::vector<mat4>* instances);
+
+#endif
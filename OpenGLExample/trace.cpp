@@ -0,0 +1,150 @@
+#include "trace.h"
+
+#include <iostream>
+
+using namespace std;
+
+#ifdef ENABLE_TRACING
+
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+struct TraceEvent{
+	const char* name;
+	long long start, duration;
+};
+
+/* written only by its thread, count is published after each event so traceWrite can read
+ * up to it while the thread goes on*/
+struct TraceBuffer{
+	static const int capacity = 1 << 16;
+
+	TraceEvent events[capacity];
+	atomic<int> count;
+	atomic<int> dropped;
+	int thread;
+	const char* name;
+
+	TraceBuffer(int _thread): count(0), dropped(0), thread(_thread), name(0){}
+};
+
+/* buffers are never freed, a thread that has finished still has its zones written out*/
+static mutex registryLock;
+static vector<TraceBuffer*> registry;
+static thread_local TraceBuffer* local = 0;
+static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+static TraceBuffer* threadBuffer()
+{
+	if(!local)
+	{
+		lock_guard<mutex> guard(registryLock);
+		local = new TraceBuffer(registry.size() + 1);
+		registry.push_back(local);
+	}
+	return local;
+}
+
+static long long microseconds()
+{
+	return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+TraceZone::TraceZone(const char* _name): name(_name), start(microseconds())
+{
+}
+
+TraceZone::~TraceZone()
+{
+	TraceBuffer* buffer = threadBuffer();
+	int c = buffer->count.load(memory_order_relaxed);
+	if(c == TraceBuffer::capacity)
+	{
+		buffer->dropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+
+	TraceEvent& e = buffer->events[c];
+	e.name = name;
+	e.start = start;
+	e.duration = microseconds() - start;
+	buffer->count.store(c + 1, memory_order_release);
+}
+
+void traceThreadName(const char* name)
+{
+	threadBuffer()->name = name;
+}
+
+/* names are literals, but a quote or backslash would still break the file*/
+static void writeString(ofstream& out, const char* s)
+{
+	out << '"';
+	for(; *s; s++)
+	{
+		if(*s == '"' || *s == '\\')
+			out << '\\';
+		out << *s;
+	}
+	out << '"';
+}
+
+bool traceWrite(const string& filename)
+{
+	ofstream out(filename.c_str());
+	if(!out.is_open())
+	{
+		cout << "Could not open " << filename << " for the trace" << endl;
+		return false;
+	}
+
+	lock_guard<mutex> guard(registryLock);
+	out << "{\"traceEvents\":[\n";
+	bool first = true;
+	int zones = 0, dropped = 0;
+	for(size_t b = 0; b < registry.size(); b++)
+	{
+		const TraceBuffer* buffer = registry[b];
+		if(buffer->name)
+		{
+			out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+				<< buffer->thread << ",\"args\":{\"name\":";
+			writeString(out, buffer->name);
+			out << "}}";
+			first = false;
+		}
+
+		int count = buffer->count.load(memory_order_acquire);
+		for(int e = 0; e < count; e++)
+		{
+			const TraceEvent& event = buffer->events[e];
+			out << (first ? "" : ",\n") << "{\"name\":";
+			writeString(out, event.name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread
+				<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+			first = false;
+		}
+		zones += count;
+		dropped += buffer->dropped.load(memory_order_relaxed);
+	}
+	out << "\n]}\n";
+
+	cout << "Traced " << zones << " zones on " << registry.size() << " threads to " << filename;
+	if(dropped > 0)
+		cout << ", " << dropped << " more did not fit";
+	cout << endl;
+	return out.good();
+}
+
+#else
+
+bool traceWrite(const string& filename)
+{
+	cout << "Tracing is compiled out, build with make TRACE=1 to write " << filename << endl;
+	return false;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+
+/* A timeline of named zones, written as Chrome trace-event JSON for chrome://tracing or
+ * Perfetto. Each thread appends to its own fixed buffer, so a zone takes no lock, and a
+ * full buffer drops the zones after it. Zones only exist in builds with ENABLE_TRACING
+ * (make TRACE=1), otherwise TRACE_ZONE and TRACE_THREAD are nothing at all.
+ *
+ *	TRACE_ZONE("subdivideCurve");	//times the rest of the enclosing scope
+ *
+ * Names are kept as pointers, so they must be string literals or outlive traceWrite. */
+
+#ifdef ENABLE_TRACING
+
+class TraceZone{
+public:
+	explicit TraceZone(const char* name);
+	~TraceZone();
+
+private:
+	const char* name;
+	long long start;	//microseconds since the first zone
+};
+
+/* names the calling thread's row of the timeline */
+void traceThreadName(const char* name);
+
+#define TRACE_JOIN_(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN_(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_JOIN(traceZone, __LINE__)(name)
+#define TRACE_THREAD(name) traceThreadName(name)
+
+#else
+
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+
+#endif
+
+/* writes every thread's zones so far, false if tracing is compiled out or the file can't be written */
+bool traceWrite(const std::string& filename);
+
+#endif
@@ -0,0 +1,46 @@
+#include "trackedit.h"
+
+using namespace std;
+
+/* one pass of subdivision() on an open polyline, the same split then average arithmetic
+ * so the rebuilt run matches the full curve exactly*/
+static void subdivideOpen(const vector<vec3>& points, vector<vec3>* out)
+{
+	out->resize(2*(points.size() - 1));
+	for(size_t i = 0; i + 1 < points.size(); i++)
+	{
+		vec3 midPoint = 0.5f*(points[i] + points[i + 1]);
+		(*out)[2*i] = 0.5f*(points[i] + midPoint);
+		(*out)[2*i + 1] = 0.5f*(midPoint + points[i + 1]);
+	}
+}
+
+bool resubdivideSpan(const vector<vec3>& control, int levels, int changed,
+					vector<vec3>* curve, int* first, int* count)
+{
+	int n = control.size();
+	int scale = 1 << levels;
+	if(n < 5 || (int)curve->size() != n*scale)
+		return false;
+
+	/* two control points either side cover every subdivided point the changed one reaches*/
+	vector<vec3> window, refined;
+	for(int k = -2; k <= 2; k++)
+		window.push_back(control[((changed + k) % n + n) % n]);
+
+	for(int l = 0; l < levels; l++)
+	{
+		subdivideOpen(window, &refined);
+		window.swap(refined);
+	}
+
+	/* output 2i of a pass comes from inputs i and i+1, so the window starts scale times further along*/
+	int total = curve->size();
+	int start = ((changed - 2 + n) % n)*scale;
+	for(size_t k = 0; k < window.size(); k++)
+		(*curve)[(start + k) % total] = window[k];
+
+	*first = start;
+	*count = window.size();
+	return true;
+}
@@ -0,0 +1,19 @@
+#ifndef TRACKEDIT_H
+#define TRACKEDIT_H
+
+#include "glm/glm.hpp"
+#include <vector>
+
+using namespace glm;
+
+/* Each subdivision pass only averages neighbouring points, so moving one control point only
+ * moves a short run of the subdivided curve. These helpers rebuild just that run. */
+
+/* Recomputes the part of curve, the closed control polygon control subdivided levels times,
+ * that depends on control[changed]. The rebuilt run starts at *first and is *count points long,
+ * and may wrap past the end of curve. Returns false if the polygon is too small for a local
+ * update, in which case curve is left alone and the caller should subdivide it all again */
+bool resubdivideSpan(const std::vector<vec3>& control, int levels, int changed,
+					std::vector<vec3>* curve, int* first, int* count);
+
+#endif
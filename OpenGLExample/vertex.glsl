@@ -13,12 +13,20 @@ layout(location = 1) in vec3 VertexNormal;
 
 uniform mat4 perspectiveMatrix;
 uniform mat4 modelviewMatrix;
+uniform mat3 normalMatrix;
 // output to be interpolated between vertices and passed to the fragment stage
 
 out vec3 FragNormal;
+out vec3 WorldPosition;
+
+// the depth prepass and the shading pass use different programs on this shader,
+// their depths must come out the same
+invariant gl_Position;
 
 void main()
 {
-	FragNormal = VertexNormal;
-	gl_Position = perspectiveMatrix*modelviewMatrix*vec4(VertexPosition, 1.0);
+	FragNormal = normalMatrix*VertexNormal;
+	vec4 world = modelviewMatrix*vec4(VertexPosition, 1.0);
+	WorldPosition = world.xyz;
+	gl_Position = perspectiveMatrix*world;
 }
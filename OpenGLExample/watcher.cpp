@@ -0,0 +1,115 @@
+#include "watcher.h"
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+using namespace std;
+
+static time_t modifiedTime(const string& filename)
+{
+	struct stat info;
+	return (stat(filename.c_str(), &info) == 0) ? info.st_mtime : 0;
+}
+
+/* "shaders/a.glsl" -> "shaders/", "a.glsl" -> "" */
+static string directoryOf(const string& filename)
+{
+	size_t slash = filename.find_last_of('/');
+	return (slash == string::npos) ? string() : filename.substr(0, slash + 1);
+}
+
+FileWatcher::FileWatcher(): fd(-1)
+{
+#ifdef __linux__
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(fd < 0)
+		cout << "inotify unavailable, checking file times instead" << endl;
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if(fd >= 0)
+		close(fd);
+#endif
+}
+
+bool FileWatcher::watch(const string& filename)
+{
+	files.push_back(filename);
+	modified.push_back(modifiedTime(filename));
+
+#ifdef __linux__
+	if(fd >= 0)
+	{
+		string directory = directoryOf(filename);
+		string path = directory.empty() ? string(".") : directory;
+		int wd = inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if(wd < 0)
+		{
+			cout << "Could not watch " << path << endl;
+			return false;
+		}
+		directories[wd] = directory;
+	}
+#endif
+	return true;
+}
+
+vector<string> FileWatcher::changed()
+{
+	vector<string> result;
+	result.swap(pending);
+
+#ifdef __linux__
+	if(fd >= 0)
+	{
+		/* drain every queued event, a single save can raise several*/
+		char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+		ssize_t length;
+		while((length = read(fd, buffer, sizeof(buffer))) > 0)
+		{
+			for(char* p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len)
+			{
+				struct inotify_event* event = (struct inotify_event*)p;
+				if(event->len == 0)
+					continue;
+
+				string name = directories[event->wd] + event->name;
+				if(find(files.begin(), files.end(), name) != files.end()
+					&& find(result.begin(), result.end(), name) == result.end())
+					result.push_back(name);
+			}
+		}
+		return result;
+	}
+#endif
+
+	for(size_t i = 0; i < files.size(); i++)
+	{
+		time_t t = modifiedTime(files[i]);
+		if(t != modified[i])
+		{
+			modified[i] = t;
+			if(find(result.begin(), result.end(), files[i]) == result.end())
+				result.push_back(files[i]);
+		}
+	}
+	return result;
+}
+
+void FileWatcher::ignore(const string& filename)
+{
+	vector<string> seen = changed();
+	for(size_t i = 0; i < seen.size(); i++)
+		if(seen[i] != filename)
+			pending.push_back(seen[i]);
+}
@@ -0,0 +1,31 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+
+/* Reports which of a set of files changed on disk. On Linux it uses inotify on the files'
+ * directories, so editors that save by renaming a new file over the old one are still seen.
+ * Elsewhere it compares modification times each time it is asked. */
+class FileWatcher{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	bool watch(const std::string& filename);
+	/* the watched files written since the last call, never blocks */
+	std::vector<std::string> changed();
+	/* forgets the writes to filename so far, for a file the program wrote itself */
+	void ignore(const std::string& filename);
+
+private:
+	std::vector<std::string> files;
+	std::vector<std::string> pending;	//changes seen by ignore that belong to other files
+	int fd;
+	std::map<int, std::string> directories;	//inotify watch -> directory prefix of its files
+	std::vector<time_t> modified;
+};
+
+#endif